@@ -10,7 +10,8 @@ path_to_cxx_compiler = '/usr/bin/g++'
 path_to_output = '/home/merzljak/async/benchmark_results/tpch_q14.csv'
 numactl = ['numactl', '--membind=0', '--cpubind=0']
 
-page_size_power_list = [12]
+lineitem_page_size_power = 19
+part_page_size_power_list = [12]
 num_threads_list = [1, 2, 4, 8, 16, 32, 64, 128]
 num_entries_per_ring_list = [8, 16, 32, 64, 128, 256, 512]
 num_tuples_per_morsel_list = [500, 1_000]
@@ -18,23 +19,27 @@ num_tuples_per_morsel_list = [500, 1_000]
 output = open(path_to_output, 'w')
 print_header = "true"
 
-for page_size_power in page_size_power_list:
-    # Configure the project
-    print(f'Configure the project with page size power of {page_size_power}')
-    subprocess.run(['cmake', '-S', path_to_source_directory, '-B', path_to_build_directory, '-DCMAKE_BUILD_TYPE=Release',
-                   f'-DASYNCHRONOUS_IO_PAGE_SIZE_POWER={page_size_power}', f'-DCMAKE_CXX_COMPILER={path_to_cxx_compiler}'], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    # Build the project
-    print(f'Build the project with page size power of {page_size_power}')
-    subprocess.run(
-        ['cmake', '--build', path_to_build_directory, '--clean-first'], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    # Load the data
-    print(f'Load the data with page size power of {page_size_power}')
-    lineitem_dat = os.path.join(path_to_data_directory, 'lineitem.dat')
+# Configure the project
+print('Configure the project')
+subprocess.run(['cmake', '-S', path_to_source_directory, '-B', path_to_build_directory, '-DCMAKE_BUILD_TYPE=Release',
+               f'-DCMAKE_CXX_COMPILER={path_to_cxx_compiler}'], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+# Build the project once, the executables support all page sizes
+print('Build the project')
+subprocess.run(
+    ['cmake', '--build', path_to_build_directory], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+# Load lineitem with large pages for the sequential scan
+print(f'Load lineitem with page size power of {lineitem_page_size_power}')
+lineitem_dat = os.path.join(path_to_data_directory, 'lineitem.dat')
+subprocess.run(numactl + [os.path.join(path_to_build_directory, 'storage', 'load_data'),
+               f'--page-size-power={lineitem_page_size_power}', 'lineitemQ14', os.path.join(path_to_tpch_directory, 'lineitem.tbl'), lineitem_dat], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+for page_size_power in part_page_size_power_list:
+    # Load part with small pages for the random lookups
+    print(f'Load part with page size power of {page_size_power}')
     part_dat = os.path.join(path_to_data_directory, 'part.dat')
     subprocess.run(numactl + [os.path.join(path_to_build_directory, 'storage', 'load_data'),
-                   'lineitemQ14', os.path.join(path_to_tpch_directory, 'lineitem.tbl'), lineitem_dat], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    subprocess.run(numactl + [os.path.join(path_to_build_directory, 'storage', 'load_data'),
-                   'part', os.path.join(path_to_tpch_directory, 'part.tbl'), part_dat], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                   f'--page-size-power={page_size_power}', 'partQ14', os.path.join(path_to_tpch_directory, 'part.tbl'), part_dat], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
 
     # Execute the query using all possible configurations
     for num_threads, num_entries_per_ring, num_tuples_per_morsel in itertools.product(num_threads_list, num_entries_per_ring_list, num_tuples_per_morsel_list):
@@ -11,7 +11,8 @@ path_to_query1_out = "/home/merzljak/async/benchmark/query1_out.csv"
 path_to_query14_out = "/home/merzljak/async/benchmark/query14_out.csv"
 
 page_size_powers_q1 = [12, 14, 16, 18, 20, 22]
-page_size_powers_q14 = [12, 13, 14, 15, 16]
+page_size_power_lineitem_q14 = 19
+page_size_powers_part_q14 = [12, 13, 14, 15, 16]
 num_threads = [2, 4, 8, 12, 16, 20]
 num_entries_per_ring = [2, 4, 8, 16, 32, 64]
 do_work = ['true', 'false']
@@ -22,15 +23,17 @@ query1_out = open(path_to_query1_out, "w")
 query14_out = open(path_to_query14_out, "w")
 print_header = "true"
 
+# the executables support all page sizes, so the project is built only once
+subprocess.run(["cmake", "-S", path_to_source_directory, "-B", path_to_build_directory, "-DCMAKE_BUILD_TYPE=Release",
+               "-DCMAKE_CXX_COMPILER={}".format(path_to_cxx_compiler)], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+subprocess.run(
+    ["cmake", "--build", path_to_build_directory], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
 for page_size_power in page_size_powers_q1:
-    subprocess.run(["cmake", "-S", path_to_source_directory, "-B", path_to_build_directory, "-DCMAKE_BUILD_TYPE=Release",
-                   "-DASYNCHRONOUS_IO_PAGE_SIZE_POWER={}".format(page_size_power), "-DCMAKE_CXX_COMPILER={}".format(path_to_cxx_compiler)], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    subprocess.run(
-        ["cmake", "--build", path_to_build_directory, "--clean-first"], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
     lineitemq1 = os.path.join(path_to_data_directory, "lineitemQ1.dat")
     part = os.path.join(path_to_data_directory, "part.dat")
     subprocess.run([os.path.join(path_to_build_directory, "executables", "load_data"),
-                   "lineitemQ1", os.path.join(path_to_tpch_directory, "lineitem.tbl"), lineitemq1], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                   "--page-size-power={}".format(page_size_power), "lineitemQ1", os.path.join(path_to_tpch_directory, "lineitem.tbl"), lineitemq1], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
 
     print_header = "true"
     for threads, entries_per_ring, work, random_io in itertools.product(num_threads, num_entries_per_ring, do_work, do_random_io):
@@ -38,17 +41,16 @@ for page_size_power in page_size_powers_q1:
                        lineitemq1, str(threads), str(entries_per_ring), work, random_io, "false", print_header], check=True, stdout=query1_out, stderr=subprocess.PIPE)
         print_header = "false"
 
-for page_size_power in page_size_powers_q14:
-    subprocess.run(["cmake", "-S", path_to_source_directory, "-B", path_to_build_directory, "-DCMAKE_BUILD_TYPE=Release",
-                   "-DASYNCHRONOUS_IO_PAGE_SIZE_POWER={}".format(page_size_power), "-DCMAKE_CXX_COMPILER={}".format(path_to_cxx_compiler)], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    subprocess.run(
-        ["cmake", "--build", path_to_build_directory, "--clean-first"], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    lineitemq14 = os.path.join(path_to_data_directory, "lineitemQ14.dat")
+# lineitem is scanned sequentially and keeps its large pages, only the page size
+# of part, which is probed randomly, is varied
+lineitemq14 = os.path.join(path_to_data_directory, "lineitemQ14.dat")
+subprocess.run([os.path.join(path_to_build_directory, "executables", "load_data"),
+               "--page-size-power={}".format(page_size_power_lineitem_q14), "lineitemQ14", os.path.join(path_to_tpch_directory, "lineitem.tbl"), lineitemq14], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+for page_size_power in page_size_powers_part_q14:
     part = os.path.join(path_to_data_directory, "part.dat")
     subprocess.run([os.path.join(path_to_build_directory, "executables", "load_data"),
-                   "lineitemQ14", os.path.join(path_to_tpch_directory, "lineitem.tbl"), lineitemq14], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    subprocess.run([os.path.join(path_to_build_directory, "executables", "load_data"),
-                   "part", os.path.join(path_to_tpch_directory, "part.tbl"), part], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                   "--page-size-power={}".format(page_size_power), "partQ14", os.path.join(path_to_tpch_directory, "part.tbl"), part], check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
 
     print_header = "true"
     for threads, entries_per_ring, tuples_per_coroutine in itertools.product(num_threads, num_entries_per_ring, num_tuples_per_coroutine):
@@ -1,4 +1,10 @@
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <atomic>
 #include <cassert>
 #include <cstdint>
@@ -10,17 +16,28 @@
 #include <random>
 #include <span>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "cppcoro/sync_wait.hpp"
 #include "cppcoro/task.hpp"
 #include "cppcoro/when_all_ready.hpp"
+#include "storage/catalog.h"
+#include "storage/column_store.h"
+#include "storage/compression.h"
 #include "storage/file.h"
 #include "storage/io_uring.h"
+#include "storage/numa.h"
+#include "storage/pipeline.h"
 #include "storage/schema.h"
 #include "storage/swip.h"
 #include "storage/types.h"
+#include "storage/worker_pool.h"
+#include "storage/zone_map.h"
 
 namespace {
 using namespace storage;
@@ -28,14 +45,60 @@ using namespace storage;
 bool do_work = true;
 uint64_t num_tuples_per_morsel = 1'000;
 
+constexpr size_t kDecodeBlockSize = 1ull << 14;
+
+// l_shipdate <= date '1998-12-01' - interval '90' day
+Date GetHighDate() { return Date::FromString("1998-09-02|", '|').value; }
+
+// DataFile is either a File of pages or a ColumnStore of row groups
+template <typename Page, typename DataFile>
 class Cache {
  public:
-  Cache(std::span<Swip> swips, const File &data_file)
-      : swips_(swips), data_file_(data_file) {
-    frames_.reserve(swips.size());
-  }
+  Cache(std::span<Swip> swips, const DataFile &data_file)
+      : swips_(swips), data_file_(data_file), frames_(swips.size()) {}
 
+  // Every NUMA node loads its share of the pages into frames that are local to
+  // that node
   void Populate(std::span<const uint64_t> swip_indexes) {
+    const auto &nodes = GetNumaNodes();
+    uint64_t partition_size =
+        (swip_indexes.size() + nodes.size() - 1) / nodes.size();
+
+    // the coroutines that load the pages cannot report errors, so the frames
+    // are checked before any page is loaded
+    for (uint64_t i = 0; i != nodes.size(); ++i) {
+      uint64_t begin = std::min(i * partition_size, swip_indexes.size());
+      auto end = std::min(begin + partition_size, swip_indexes.size());
+      if (frames_.GetNumFreeFrames(nodes[i]) < end - begin) {
+        throw std::runtime_error{
+            "Not enough frames on NUMA node " + std::to_string(nodes[i]) +
+            " to cache " + std::to_string(end - begin) + " more pages"};
+      }
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(nodes.size());
+
+    for (uint64_t i = 0; i != nodes.size(); ++i) {
+      uint64_t begin = std::min(i * partition_size, swip_indexes.size());
+      auto end = std::min(begin + partition_size, swip_indexes.size());
+      threads.emplace_back(
+          [this, node = nodes[i],
+           local_swip_indexes = swip_indexes.subspan(begin, end - begin)] {
+            BindCurrentThreadToNumaNode(node);
+            PopulateLocal(node, local_swip_indexes);
+          });
+    }
+
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+
+  const NumaFramePool<Page> &GetFrames() const noexcept { return frames_; }
+
+ private:
+  void PopulateLocal(NumaNode node, std::span<const uint64_t> swip_indexes) {
     constexpr uint64_t kNumConcurrentTasks = 64ull;
     IOUring ring(kNumConcurrentTasks);
     Countdown countdown(kNumConcurrentTasks);
@@ -50,282 +113,400 @@ class Cache {
       uint64_t begin = std::min(i * partition_size, swip_indexes.size());
       auto end = std::min(begin + partition_size, swip_indexes.size());
       tasks.emplace_back(
-          AsyncLoadPages(ring, begin, end, countdown, swip_indexes));
+          AsyncLoadPages(ring, begin, end, countdown, swip_indexes, node));
     }
     tasks.emplace_back(DrainRing(ring, countdown));
     cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
   }
 
- private:
   cppcoro::task<void> AsyncLoadPages(IOUring &ring, uint64_t begin,
                                      uint64_t end, Countdown &countdown,
-                                     std::span<const uint64_t> swip_indexes) {
+                                     std::span<const uint64_t> swip_indexes,
+                                     NumaNode node) {
     for (uint64_t i = begin; i != end; ++i) {
-      frames_.emplace_back();
-      LineitemPageQ1 &page = frames_.back();
-      co_await data_file_.AsyncReadPage(ring,
-                                        swips_[swip_indexes[i]].GetPageIndex(),
-                                        reinterpret_cast<std::byte *>(&page));
-      swips_[swip_indexes[i]].SetPointer(&page);
+      // Populate() has checked that the node has enough frames
+      Page *page = frames_.Allocate(node);
+      assert(page != nullptr);
+      co_await data_file_.AsyncReadPage(
+          ring, swips_[swip_indexes[i]].GetPageIndex(), page);
+      swips_[swip_indexes[i]].SetPointer(page);
     }
     countdown.Decrement();
   }
 
   std::span<Swip> swips_;
-  const File &data_file_;
-  std::vector<LineitemPageQ1> frames_;
+  const DataFile &data_file_;
+  NumaFramePool<Page> frames_;
 };
 
-struct HashTableEntry {
-  Numeric<12, 2> sum_qty;
-  Numeric<12, 2> sum_base_price;
-  Numeric<12, 2> sum_disc;
-  Numeric<12, 4> sum_disc_price;
-  Numeric<12, 4> sum_charge;
-  uint32_t count;
+// The aggregates of one group of query 1. The sums are 128 bits wide, so that
+// they do not overflow for large scale factors.
+struct Aggregates {
+  NumericSum<12, 2> sum_qty;
+  NumericSum<12, 2> sum_base_price;
+  NumericSum<12, 2> sum_disc;
+  NumericSum<12, 4> sum_disc_price;
+  NumericSum<12, 4> sum_charge;
+  uint64_t count;
   Char l_returnflag;
   Char l_linestatus;
 };
 
-using HashTable = std::vector<std::unique_ptr<HashTableEntry>>;
-using ValidHashTableIndexes = std::vector<uint32_t>;
-
-// implementation idea for query 1 stolen from the MonetDB/X100 paper
-class QueryRunner {
+// Processes one tuple at a time and looks up the group of every tuple in a
+// hash table with one slot per combination of l_returnflag and l_linestatus
+class HashAggregation {
  public:
-  QueryRunner(uint32_t num_threads, std::span<const Swip> swips,
-              const File &data_file, uint32_t num_ring_entries = 0)
-      : thread_local_hash_tables_(num_threads),
-        thread_local_valid_hash_table_indexes_(num_threads),
-        high_date_(Date::FromString("1998-09-02|", '|').value),
-        num_threads_(num_threads),
-        swips_(swips),
-        data_file_(data_file),
-        num_ring_entries_(num_ring_entries) {
-    for (auto &hash_table : thread_local_hash_tables_) {
-      hash_table.resize(1ull << 16);
-    }
+  static constexpr std::string_view kName = "hash";
 
-    if (num_ring_entries > 0) {
-      thread_local_rings_.reserve(num_threads);
-      for (uint32_t i = 0; i != num_threads; ++i) {
-        thread_local_rings_.emplace_back(num_ring_entries);
-      }
-    }
-  }
+  HashAggregation() : hash_table_(1ull << 16) {}
 
-  static void ProcessTuples(const LineitemPageQ1 &page, HashTable &hash_table,
-                            ValidHashTableIndexes &valid_hash_table_indexes,
-                            Date high_date) {
+  template <bool kAllQualify, typename Tuples>
+  void ProcessTuples(const Tuples &page, Date high_date) {
     Numeric<12, 2> one{int64_t{100}};  // assigns a raw value
     for (uint32_t i = 0; i != page.num_tuples; ++i) {
-      if (page.l_shipdate[i] <= high_date) {
-        uint32_t hash_table_index = page.l_returnflag[i];
-        hash_table_index = (hash_table_index << 8) + page.l_linestatus[i];
-        auto &entry = hash_table[hash_table_index];
+      if (kAllQualify || page.l_shipdate()[i] <= high_date) {
+        uint32_t hash_table_index = page.l_returnflag()[i];
+        hash_table_index = (hash_table_index << 8) + page.l_linestatus()[i];
+        auto &entry = hash_table_[hash_table_index];
         if (!entry) {
-          entry = std::make_unique<HashTableEntry>();
-          entry->l_returnflag = page.l_returnflag[i];
-          entry->l_linestatus = page.l_linestatus[i];
+          entry = std::make_unique<Aggregates>();
+          entry->l_returnflag = page.l_returnflag()[i];
+          entry->l_linestatus = page.l_linestatus()[i];
           entry->count = 0;
-          valid_hash_table_indexes.push_back(hash_table_index);
+          valid_hash_table_indexes_.push_back(hash_table_index);
         }
 
         ++entry->count;
-        entry->sum_qty += page.l_quantity[i];
-        entry->sum_base_price += page.l_extendedprice[i];
-        entry->sum_disc += page.l_discount[i];
+        entry->sum_qty += page.l_quantity()[i];
+        entry->sum_base_price += page.l_extendedprice()[i];
+        entry->sum_disc += page.l_discount()[i];
         Numeric<12, 4> common_term =
-            page.l_extendedprice[i] * (one - page.l_discount[i]);
+            page.l_extendedprice()[i] * (one - page.l_discount()[i]);
         entry->sum_disc_price += common_term;
-        entry->sum_charge += common_term.CastM2() * (one + page.l_tax[i]);
+        entry->sum_charge += common_term.CastM2() * (one + page.l_tax()[i]);
       }
     }
   }
 
-  static void ProcessPages(LineitemPageQ1 &page, std::span<const Swip> swips,
-                           HashTable &hash_table,
-                           ValidHashTableIndexes &valid_hash_table_indexes,
-                           Date high_date, const File &data_file) {
-    for (auto swip : swips) {
-      LineitemPageQ1 *data;
-
-      if (swip.IsPageIndex()) {
-        data_file.ReadPage(swip.GetPageIndex(),
-                           reinterpret_cast<std::byte *>(&page));
-        data = &page;
+  std::vector<Aggregates> GetGroups() const {
+    std::vector<Aggregates> groups;
+    for (auto valid_hash_table_index : valid_hash_table_indexes_) {
+      groups.push_back(*hash_table_[valid_hash_table_index]);
+    }
+    return groups;
+  }
+
+ private:
+  std::vector<std::unique_ptr<Aggregates>> hash_table_;
+  std::vector<uint32_t> valid_hash_table_indexes_;
+};
+
+// Processes the tuples vector at a time in the style of MonetDB/X100. The
+// qualifying tuples of a vector are collected in a selection vector with SIMD
+// comparisons of l_shipdate, then the expressions are evaluated column by
+// column. The groups are kept in a flat array that is indexed by dense ids of
+// l_returnflag and l_linestatus and stays in the L1 cache.
+class alignas(64) VectorizedAggregation {
+ public:
+  static constexpr std::string_view kName = "vectorized";
+
+  template <bool kAllQualify, typename Tuples>
+  void ProcessTuples(const Tuples &tuples, Date high_date) {
+    for (uint32_t begin = 0; begin < tuples.num_tuples; begin += kVectorSize) {
+      uint32_t size = std::min(kVectorSize, tuples.num_tuples - begin);
+      if constexpr (kAllQualify) {
+        std::iota(selection_.begin(), selection_.begin() + size, begin);
+        ProcessVector(tuples, size);
       } else {
-        data = swip.GetPointer<LineitemPageQ1>();
+        ProcessVector(tuples, Select(tuples.l_shipdate().data(), begin, size,
+                                     high_date));
       }
-      if (do_work) {
-        ProcessTuples(*data, hash_table, valid_hash_table_indexes, high_date);
+    }
+  }
+
+  std::vector<Aggregates> GetGroups() const {
+    std::vector<Aggregates> groups;
+    for (uint32_t group_id = 0; group_id != kMaxNumGroups; ++group_id) {
+      if (groups_[group_id].count == 0) {
+        continue;
       }
+      Aggregates group = groups_[group_id];
+      group.l_returnflag = returnflags_.GetValue(group_id / kMaxNumValues);
+      group.l_linestatus = linestatuses_.GetValue(group_id % kMaxNumValues);
+      groups.push_back(group);
     }
+    return groups;
   }
 
-  static cppcoro::task<void> AsyncProcessPages(
-      LineitemPageQ1 &page, std::vector<Swip> swips, HashTable &hash_table,
-      ValidHashTableIndexes &valid_hash_table_indexes, Date high_date,
-      const File &data_file, IOUring &ring, Countdown &countdown) {
-    std::partition(swips.begin(), swips.end(),
-                   [](Swip swip) { return swip.IsPageIndex(); });
-    for (auto swip : swips) {
-      LineitemPageQ1 *data;
-
-      if (swip.IsPageIndex()) {
-        co_await data_file.AsyncReadPage(ring, swip.GetPageIndex(),
-                                         reinterpret_cast<std::byte *>(&page));
-        data = &page;
-      } else {
-        data = swip.GetPointer<LineitemPageQ1>();
+ private:
+  static constexpr uint32_t kVectorSize = 1024;
+  // TPC-H has three return flags and two line statuses
+  static constexpr uint32_t kMaxNumValues = 8;
+  static constexpr uint32_t kMaxNumGroups = kMaxNumValues * kMaxNumValues;
+
+  // Assigns dense ids to the values of a grouping column in the order in which
+  // they occur
+  class Dictionary {
+   public:
+    Dictionary() noexcept { ids_.fill(kNoId); }
+
+    uint32_t GetId(Char value) {
+      auto &id = ids_[static_cast<unsigned char>(value)];
+      if (id == kNoId) [[unlikely]] {
+        if (num_values_ == kMaxNumValues) {
+          throw std::runtime_error{"Too many groups for the vectorized kernel"};
+        }
+        values_[num_values_] = value;
+        id = num_values_++;
       }
-      if (do_work) {
-        ProcessTuples(*data, hash_table, valid_hash_table_indexes, high_date);
+      return id;
+    }
+
+    Char GetValue(uint32_t id) const noexcept { return values_[id]; }
+
+   private:
+    static constexpr uint8_t kNoId = 0xff;
+
+    std::array<uint8_t, 256> ids_;
+    std::array<Char, kMaxNumValues> values_{};
+    uint8_t num_values_{0};
+  };
+
+  // Writes the indexes of the tuples in [begin, begin + size) that were shipped
+  // on or before high_date to the selection vector and returns their number
+  uint32_t Select(const Date *shipdates, uint32_t begin, uint32_t size,
+                  Date high_date) noexcept {
+    const auto *dates = reinterpret_cast<const uint32_t *>(shipdates + begin);
+    uint32_t num_selected = 0;
+    uint32_t i = 0;
+#ifdef __AVX512F__
+    const auto high = _mm512_set1_epi32(high_date.GetRaw());
+    auto indexes =
+        _mm512_add_epi32(_mm512_set1_epi32(begin),
+                         _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+                                           11, 12, 13, 14, 15));
+    for (; i + 16 <= size; i += 16) {
+      __mmask16 mask =
+          _mm512_cmple_epu32_mask(_mm512_loadu_si512(dates + i), high);
+      _mm512_mask_compressstoreu_epi32(selection_.data() + num_selected, mask,
+                                       indexes);
+      num_selected += std::popcount(mask);
+      indexes = _mm512_add_epi32(indexes, _mm512_set1_epi32(16));
+    }
+#elif defined(__AVX2__)
+    const auto high = _mm256_set1_epi32(high_date.GetRaw());
+    for (; i + 8 <= size; i += 8) {
+      auto values =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dates + i));
+      // there is no unsigned comparison, but x <= high iff max(x, high) == high
+      uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+          _mm256_cmpeq_epi32(_mm256_max_epu32(values, high), high)));
+      for (; mask != 0; mask &= mask - 1) {
+        selection_[num_selected++] = begin + i + std::countr_zero(mask);
       }
     }
-    countdown.Decrement();
+#endif
+    for (; i != size; ++i) {
+      selection_[num_selected] = begin + i;
+      num_selected += dates[i] <= high_date.GetRaw();
+    }
+    return num_selected;
   }
 
-  bool IsSynchronous() const noexcept { return num_ring_entries_ == 0; }
+  // Aggregates the first num_selected tuples of the selection vector
+  template <typename Tuples>
+  void ProcessVector(const Tuples &tuples, uint32_t num_selected) {
+    auto returnflags = tuples.l_returnflag();
+    auto linestatuses = tuples.l_linestatus();
+    for (uint32_t k = 0; k != num_selected; ++k) {
+      auto i = selection_[k];
+      group_ids_[k] = returnflags_.GetId(returnflags[i]) * kMaxNumValues +
+                      linestatuses_.GetId(linestatuses[i]);
+    }
 
-  void StartProcessing() {
-    std::atomic<uint64_t> current_swip{0ull};
-    std::vector<std::thread> threads;
-    threads.reserve(num_threads_);
+    Numeric<12, 2> one{int64_t{100}};  // assigns a raw value
+    auto prices = tuples.l_extendedprice();
+    auto discounts = tuples.l_discount();
+    auto taxes = tuples.l_tax();
+    for (uint32_t k = 0; k != num_selected; ++k) {
+      auto i = selection_[k];
+      disc_prices_[k] = prices[i] * (one - discounts[i]);
+    }
+    for (uint32_t k = 0; k != num_selected; ++k) {
+      charges_[k] = disc_prices_[k].CastM2() * (one + taxes[selection_[k]]);
+    }
 
-    for (uint32_t thread_index = 0; thread_index != num_threads_;
-         ++thread_index) {
-      threads.emplace_back(
-          [&hash_table = thread_local_hash_tables_[thread_index],
-           &valid_hash_table_indexes =
-               thread_local_valid_hash_table_indexes_[thread_index],
-           high_date = high_date_, &current_swip, num_swips = swips_.size(),
-           &swips = swips_, &data_file = data_file_,
-           is_synchronous = IsSynchronous(),
-           &ring = thread_local_rings_[thread_index],
-           num_ring_entries = num_ring_entries_] {
-            if (!is_synchronous) {
-              cppcoro::detail::allocator = new Allocator(num_ring_entries);
-              cppcoro::detail::sync_allocator = new Allocator(1);
-            }
-            std::allocator<LineitemPageQ1> alloc;
-            auto pages = alloc.allocate(is_synchronous ? 1 : num_ring_entries);
-
-            // process ceil(num_tuples_per_morsel / kMaxNumTuples) pages per
-            // morsel
-            // => each morsel contains circa num_tuples_per_morsel tuples
-            const uint64_t kSyncFetchIncrement =
-                (num_tuples_per_morsel + LineitemPageQ1::kMaxNumTuples - 1) /
-                LineitemPageQ1::kMaxNumTuples;
-
-            uint64_t fetch_increment;
-
-            if (is_synchronous) {
-              fetch_increment = kSyncFetchIncrement;
-            } else {
-              // process num_ring_entries morsels together
-              fetch_increment = kSyncFetchIncrement * num_ring_entries;
-            }
-
-            while (true) {
-              auto begin = current_swip.fetch_add(fetch_increment);
-              if (begin >= num_swips) {
-                return;
-              }
-              auto end = std::min(num_swips, begin + fetch_increment);
-              auto size = end - begin;
-
-              if (is_synchronous) {
-                ProcessPages(pages[0], swips.subspan(begin, size), hash_table,
-                             valid_hash_table_indexes, high_date, data_file);
-              } else {
-                Countdown countdown(num_ring_entries);
-                std::vector<cppcoro::task<void>> tasks;
-                tasks.reserve(num_ring_entries + 1);
-
-                auto num_pages_per_task =
-                    (size + num_ring_entries - 1) / num_ring_entries;
-
-                for (uint32_t i = 0; i != num_ring_entries; ++i) {
-                  auto local_begin =
-                      std::min(begin + i * num_pages_per_task, end);
-                  auto local_end =
-                      std::min(local_begin + num_pages_per_task, end);
-                  tasks.emplace_back(AsyncProcessPages(
-                      pages[i], {&swips[local_begin], &swips[local_end]},
-                      hash_table, valid_hash_table_indexes, high_date,
-                      data_file, ring, countdown));
-                }
-                tasks.emplace_back(DrainRing(ring, countdown));
-                cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
-              }
-            }
-
-            alloc.deallocate(pages, is_synchronous ? 1 : num_ring_entries);
-            if (!is_synchronous) {
-              delete cppcoro::detail::allocator;
-              cppcoro::detail::allocator = nullptr;
-              delete cppcoro::detail::sync_allocator;
-              cppcoro::detail::sync_allocator = nullptr;
-            }
-          });
+    auto quantities = tuples.l_quantity();
+    for (uint32_t k = 0; k != num_selected; ++k) {
+      auto i = selection_[k];
+      auto &group = groups_[group_ids_[k]];
+      ++group.count;
+      group.sum_qty += quantities[i];
+      group.sum_base_price += prices[i];
+      group.sum_disc += discounts[i];
+      group.sum_disc_price += disc_prices_[k];
+      group.sum_charge += charges_[k];
     }
+  }
 
-    for (auto &t : threads) {
-      t.join();
+  // the grouping values are only filled in by GetGroups()
+  std::array<Aggregates, kMaxNumGroups> groups_{};
+  Dictionary returnflags_;
+  Dictionary linestatuses_;
+  std::array<uint32_t, kVectorSize> selection_;
+  std::array<uint8_t, kVectorSize> group_ids_;
+  std::array<Numeric<12, 4>, kVectorSize> disc_prices_;
+  std::array<Numeric<12, 4>, kVectorSize> charges_;
+};
+
+// implementation idea for query 1 stolen from the MonetDB/X100 paper
+template <typename Page, typename DataFile, typename Aggregation>
+class QueryRunner {
+ public:
+  // The first num_all_qualifying_swips swips refer to pages on which all tuples
+  // satisfy the predicate. The rings of the workers need num_ring_entries
+  // entries.
+  QueryRunner(WorkerPool &workers, std::span<const Swip> swips,
+              uint64_t num_all_qualifying_swips, const DataFile &data_file,
+              const NumaFramePool<Page> &frames, uint32_t num_ring_entries = 0)
+      : thread_local_aggregations_(workers.GetNumThreads()),
+        thread_local_numa_statistics_(workers.GetNumThreads()),
+        high_date_(GetHighDate()),
+        workers_(workers),
+        swips_(swips),
+        num_all_qualifying_swips_(num_all_qualifying_swips),
+        data_file_(data_file),
+        frames_(frames),
+        num_ring_entries_(num_ring_entries) {}
+
+  // kAllQualify skips evaluating the predicate, e.g. if the zone map shows that
+  // all tuples of the page satisfy it
+  template <bool kAllQualify, typename Tuples>
+  static void ProcessTuples(const Tuples &page, Aggregation &aggregation,
+                            Date high_date) {
+    aggregation.template ProcessTuples<kAllQualify>(page, high_date);
+  }
+
+  // Decodes the page block by block into a buffer that fits into the L1 cache
+  template <bool kAllQualify, typename Uncompressed>
+  static void ProcessTuples(const CompressedPage<Uncompressed> &page,
+                            Aggregation &aggregation, Date high_date) {
+    BasicLineitemPageQ1<kDecodeBlockSize> block;
+    for (uint32_t begin = 0; begin != page.num_tuples;
+         begin += block.num_tuples) {
+      page.DecodeBlock(begin, block);
+      ProcessTuples<kAllQualify>(block, aggregation, high_date);
+    }
+  }
+
+  static void ProcessPage(const Page &page, bool all_qualify,
+                          Aggregation &aggregation, Date high_date) {
+    if (all_qualify) {
+      ProcessTuples<true>(page, aggregation, high_date);
+    } else {
+      ProcessTuples<false>(page, aggregation, high_date);
+    }
+  }
+
+  static void CountAccess(Swip swip, const NumaFramePool<Page> &frames,
+                          NumaNode node, NumaStatistics &statistics) {
+    if (swip.IsPageIndex()) {
+      ++statistics.num_misses;
+    } else if (frames.GetNode(swip.GetPointer<Page>()) == node) {
+      ++statistics.num_local_hits;
+    } else {
+      ++statistics.num_remote_hits;
+    }
+  }
+
+  // The pipeline of a worker for the scan of pipeline.h. It consumes whole
+  // pages, so that the aggregation processes them at once, and counts where
+  // they come from.
+  class PagePipeline {
+   public:
+    PagePipeline(QueryRunner &runner, unsigned thread_index)
+        : runner_(runner),
+          aggregation_(runner.thread_local_aggregations_[thread_index]),
+          statistics_(runner.thread_local_numa_statistics_[thread_index]),
+          node_(GetNumaNodes()[thread_index % GetNumaNodes().size()]) {}
+
+    void ConsumePage(const Page &page, Swip swip, uint64_t swip_index) {
+      CountAccess(swip, runner_.frames_, node_, statistics_);
+      if (do_work) {
+        ProcessPage(page, swip_index < runner_.num_all_qualifying_swips_,
+                    aggregation_, runner_.high_date_);
+      }
     }
+
+   private:
+    QueryRunner &runner_;
+    Aggregation &aggregation_;
+    NumaStatistics &statistics_;
+    const NumaNode node_;
+  };
+
+  // Every worker takes morsels of about num_tuples_per_morsel tuples from a
+  // scan of the swips, which runs num_ring_entries scan coroutines per worker
+  // with asynchronous I/O
+  void StartProcessing() {
+    std::vector<PagePipeline> pipelines;
+    pipelines.reserve(workers_.GetNumThreads());
+    for (unsigned i = 0; i != workers_.GetNumThreads(); ++i) {
+      pipelines.emplace_back(*this, i);
+    }
+    Scan<Page>(workers_, data_file_, swips_, pipelines, num_ring_entries_,
+               num_tuples_per_morsel);
+  }
+
+  NumaStatistics GetNumaStatistics() const noexcept {
+    NumaStatistics result;
+    for (const auto &statistics : thread_local_numa_statistics_) {
+      result += statistics;
+    }
+    return result;
   }
 
   void DoPostProcessing(bool should_print_result) {
     if (do_work) {
       // post-processing happens in a single thread. That's okay, because there
       // are only four groups
-      auto &result_hash_table = thread_local_hash_tables_.front();
-      auto &result_valid_hash_table_indexes =
-          thread_local_valid_hash_table_indexes_.front();
-
-      for (uint32_t i = 1; i != num_threads_; ++i) {
-        auto &local_hash_table = thread_local_hash_tables_[i];
-        for (auto valid_hash_table_index :
-             thread_local_valid_hash_table_indexes_[i]) {
-          auto &local_entry = local_hash_table[valid_hash_table_index];
-          auto &result_entry = result_hash_table[valid_hash_table_index];
-          if (result_entry) {
-            result_entry->sum_qty += local_entry->sum_qty;
-            result_entry->sum_base_price += local_entry->sum_base_price;
-            result_entry->sum_disc += local_entry->sum_disc;
-            result_entry->sum_disc_price += local_entry->sum_disc_price;
-            result_entry->sum_charge += local_entry->sum_charge;
-            result_entry->count += local_entry->count;
+      std::vector<Aggregates> result;
+      for (const auto &aggregation : thread_local_aggregations_) {
+        for (const auto &local_group : aggregation.GetGroups()) {
+          auto it = std::find_if(
+              result.begin(), result.end(), [&](const Aggregates &group) {
+                return group.l_returnflag == local_group.l_returnflag &&
+                       group.l_linestatus == local_group.l_linestatus;
+              });
+          if (it == result.end()) {
+            result.push_back(local_group);
           } else {
-            result_entry = std::move(local_entry);
-            result_valid_hash_table_indexes.push_back(valid_hash_table_index);
+            it->sum_qty += local_group.sum_qty;
+            it->sum_base_price += local_group.sum_base_price;
+            it->sum_disc += local_group.sum_disc;
+            it->sum_disc_price += local_group.sum_disc_price;
+            it->sum_charge += local_group.sum_charge;
+            it->count += local_group.count;
           }
         }
       }
-
-      std::vector<HashTableEntry *> result_entries;
-      for (auto valid_hash_table_index : result_valid_hash_table_indexes) {
-        result_entries.push_back(
-            result_hash_table[valid_hash_table_index].get());
-      }
-      std::sort(result_entries.begin(), result_entries.end(),
-                [](HashTableEntry *lhs, HashTableEntry *rhs) {
-                  return std::pair(lhs->l_returnflag, lhs->l_linestatus) <
-                         std::pair(rhs->l_returnflag, rhs->l_linestatus);
+      std::sort(result.begin(), result.end(),
+                [](const Aggregates &lhs, const Aggregates &rhs) {
+                  return std::pair(lhs.l_returnflag, lhs.l_linestatus) <
+                         std::pair(rhs.l_returnflag, rhs.l_linestatus);
                 });
 
       if (should_print_result) {
         std::cerr
             << "l_returnflag|l_linestatus|sum_qty|sum_base_price|sum_disc_"
                "price|sum_charge|avg_qty|avg_price|avg_disc|count_order\n";
-        for (auto *entry : result_entries) {
-          std::cerr << entry->l_returnflag << "|" << entry->l_linestatus << "|"
-                    << entry->sum_qty << "|" << entry->sum_base_price << "|"
-                    << entry->sum_disc_price << "|" << entry->sum_charge << "|"
-                    << entry->sum_qty / entry->count << "|"
-                    << entry->sum_base_price / entry->count << "|"
-                    << entry->sum_disc / entry->count << "|" << entry->count
+        for (const auto &group : result) {
+          std::cerr << group.l_returnflag << "|" << group.l_linestatus << "|"
+                    << group.sum_qty << "|" << group.sum_base_price << "|"
+                    << group.sum_disc_price << "|" << group.sum_charge << "|"
+                    << group.sum_qty / group.count << "|"
+                    << group.sum_base_price / group.count << "|"
+                    << group.sum_disc / group.count << "|" << group.count
                     << "\n";
         }
       }
@@ -333,54 +514,81 @@ class QueryRunner {
   }
 
  private:
-  std::vector<HashTable> thread_local_hash_tables_;
-  std::vector<ValidHashTableIndexes> thread_local_valid_hash_table_indexes_;
-  std::vector<IOUring> thread_local_rings_;
+  std::vector<Aggregation> thread_local_aggregations_;
+  std::vector<NumaStatistics> thread_local_numa_statistics_;
   const Date high_date_;
-  const uint32_t num_threads_;
+  WorkerPool &workers_;
   const std::span<const Swip> swips_;
-  const File &data_file_;
+  const uint64_t num_all_qualifying_swips_;
+  const DataFile &data_file_;
+  const NumaFramePool<Page> &frames_;
   const uint32_t num_ring_entries_;
 };
 
-std::vector<Swip> GetSwips(uint64_t size_of_data_file) {
-  auto num_pages = size_of_data_file / kPageSize;
+// Opens the data file (or the column files) for direct I/O
+template <typename DataFile>
+std::unique_ptr<DataFile> OpenDataFile(const char *path) {
+  if constexpr (std::is_same_v<DataFile, File>) {
+    return std::make_unique<File>(path, File::kRead, true);
+  } else {
+    return std::make_unique<DataFile>(path, true);
+  }
+}
+
+// The catalog also checks that the data file consists of pages of type Page
+template <typename Page>
+uint64_t GetNumPages(const char *path_to_lineitem, const File &) {
+  return Catalog::ReadFor<Page>(path_to_lineitem).GetNumPages();
+}
+
+template <typename Page, typename Group>
+uint64_t GetNumPages(const char *, const ColumnStore<Group> &column_store) {
+  return column_store.GetNumRowGroups();
+}
+
+// Returns the page size power that the data file was loaded with
+size_t GetPageSizePower(const char *path_to_lineitem, const File &) {
+  return Catalog::ReadFor(path_to_lineitem).GetHeader().page_size_power;
+}
+
+// A column store has no pages, so this returns the size power of the row group
+// of an 8-byte column, which the index of the row groups determines
+template <typename Group>
+size_t GetPageSizePower(const char *, const ColumnStore<Group> &column_store) {
+  return std::countr_zero(column_store.GetRowGroupCapacity() *
+                          sizeof(uint64_t));
+}
+
+// Returns the swips of all pages except for those on which, according to the
+// zone map, no tuple satisfies the predicate
+std::vector<Swip> GetSwips(uint64_t num_pages, const ZoneMap &zone_map,
+                           size_t shipdate_column_index) {
   std::vector<Swip> swips;
   swips.reserve(num_pages);
   for (PageIndex i = 0; i != num_pages; ++i) {
-    swips.emplace_back(Swip::MakePageIndex(i));
+    if (zone_map.Match(i, shipdate_column_index, Date{0u}, GetHighDate()) !=
+        ZoneMatch::kNone) {
+      swips.emplace_back(Swip::MakePageIndex(i));
+    }
   }
   return swips;
 }
 
-}  // namespace
-
-int main(int argc, char *argv[]) {
-  if (argc != 9) {
-    std::cerr << "Usage: " << argv[0]
-              << " lineitem.dat num_threads num_entries_per_ring "
-                 "num_tuples_per_morsel do_work "
-                 "do_random_io print_result print_header\n";
-    return 1;
-  }
-
-  std::string path_to_lineitem{argv[1]};
-  unsigned num_threads = std::atoi(argv[2]);
-  unsigned num_entries_per_ring = std::atoi(argv[3]);
-  num_tuples_per_morsel = std::atoi(argv[4]);
-  std::istringstream(argv[5]) >> std::boolalpha >> do_work;
-  bool do_random_io;
-  std::istringstream(argv[6]) >> std::boolalpha >> do_random_io;
-  bool print_result;
-  std::istringstream(argv[7]) >> std::boolalpha >> print_result;
-  bool print_header;
-  std::istringstream(argv[8]) >> std::boolalpha >> print_header;
-
-  const File file{path_to_lineitem.c_str(), File::kRead, true};
+template <typename Page, typename DataFile, typename Aggregation>
+void RunQuery(const char *path_to_lineitem, unsigned num_threads,
+              unsigned num_entries_per_ring, bool do_random_io,
+              bool print_result, bool print_header) {
+  auto data_file = OpenDataFile<DataFile>(path_to_lineitem);
+  const DataFile &file = *data_file;
   auto file_size = file.ReadSize();
-  auto swips = GetSwips(file_size);
+  auto page_size_power = GetPageSizePower(path_to_lineitem, file);
+  auto zone_map = ZoneMap::ReadFor(path_to_lineitem, Page::kNumColumns);
+  constexpr size_t kShipdateColumnIndex = LineitemPageQ1::IndexOf("l_shipdate");
+  auto swips = GetSwips(GetNumPages<Page>(path_to_lineitem, file), zone_map,
+                        kShipdateColumnIndex);
 
   std::vector<uint64_t> swip_indexes(swips.size());
+  uint64_t num_all_qualifying_swips;
   {
     std::random_device rd;
     std::mt19937 g(rd());
@@ -390,19 +598,33 @@ int main(int argc, char *argv[]) {
       std::shuffle(swips.begin(), swips.end(), g);
     }
 
+    // move the pages on which all tuples qualify to the front
+    num_all_qualifying_swips =
+        std::stable_partition(
+            swips.begin(), swips.end(),
+            [&zone_map, high_date = GetHighDate()](Swip swip) {
+              return zone_map.Match(swip.GetPageIndex(), kShipdateColumnIndex,
+                                    Date{0u}, high_date) == ZoneMatch::kAll;
+            }) -
+        swips.begin();
+
     std::iota(swip_indexes.begin(), swip_indexes.end(), 0ull);
     std::shuffle(swip_indexes.begin(), swip_indexes.end(), g);
   }
 
-  Cache cache{swips, file};
+  Cache<Page, DataFile> cache{swips, file};
 
   auto partition_size =
       (swip_indexes.size() + 9) / 10;  // divide in 10 partitions
 
+  // all runs share the threads, so they do not pay for starting them
+  WorkerPool workers{num_threads, num_entries_per_ring};
+
   if (print_header) {
     std::cout << "kind_of_io,page_size_power,num_threads,num_cached_pages,num_"
                  "total_pages,num_entries_per_ring,num_tuples_per_morsel,do_"
-                 "work,do_random_io,time,file_size,throughput\n";
+                 "work,do_random_io,time,file_size,throughput,num_local_"
+                 "hits,num_remote_hits,num_misses,kernel\n";
   }
 
   // Start with 0% cached, then 10%, then 20%, ...
@@ -415,7 +637,8 @@ int main(int argc, char *argv[]) {
     }
 
     {
-      QueryRunner synchronousRunner{num_threads, swips, file};
+      QueryRunner<Page, DataFile, Aggregation> synchronousRunner{
+          workers, swips, num_all_qualifying_swips, file, cache.GetFrames()};
       auto start = std::chrono::steady_clock::now();
       synchronousRunner.StartProcessing();
       synchronousRunner.DoPostProcessing(print_result);
@@ -423,17 +646,23 @@ int main(int argc, char *argv[]) {
       auto milliseconds =
           std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
               .count();
-      std::cout << "synchronous," << kPageSizePower << "," << num_threads << ","
-                << std::min(i * partition_size, swip_indexes.size()) << ","
-                << swip_indexes.size() << ",0," << num_tuples_per_morsel << ","
+      auto statistics = synchronousRunner.GetNumaStatistics();
+      std::cout << "synchronous," << page_size_power << "," << num_threads
+                << "," << std::min(i * partition_size, swip_indexes.size())
+                << "," << swip_indexes.size() << ",0," << num_tuples_per_morsel
+                << ","
                 << std::boolalpha << do_work << "," << do_random_io << ","
                 << milliseconds << "," << file_size << ","
-                << (file_size / 1000000000.0) / (milliseconds / 1000.0) << "\n";
+                << (file_size / 1000000000.0) / (milliseconds / 1000.0) << ","
+                << statistics.num_local_hits << ","
+                << statistics.num_remote_hits << "," << statistics.num_misses
+                << "," << Aggregation::kName << "\n";
     }
 
     {
-      QueryRunner asynchronousRunner{num_threads, swips, file,
-                                     num_entries_per_ring};
+      QueryRunner<Page, DataFile, Aggregation> asynchronousRunner{
+          workers, swips, num_all_qualifying_swips, file, cache.GetFrames(),
+          num_entries_per_ring};
       auto start = std::chrono::steady_clock::now();
       asynchronousRunner.StartProcessing();
       asynchronousRunner.DoPostProcessing(print_result);
@@ -441,13 +670,99 @@ int main(int argc, char *argv[]) {
       auto milliseconds =
           std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
               .count();
-      std::cout << "asynchronous," << kPageSizePower << "," << num_threads
+      auto statistics = asynchronousRunner.GetNumaStatistics();
+      std::cout << "asynchronous," << page_size_power << "," << num_threads
                 << "," << std::min(i * partition_size, swip_indexes.size())
                 << "," << swip_indexes.size() << "," << num_entries_per_ring
                 << "," << num_tuples_per_morsel << "," << std::boolalpha
                 << do_work << "," << do_random_io << "," << milliseconds << ","
                 << file_size << ","
-                << (file_size / 1000000000.0) / (milliseconds / 1000.0) << "\n";
+                << (file_size / 1000000000.0) / (milliseconds / 1000.0) << ","
+                << statistics.num_local_hits << ","
+                << statistics.num_remote_hits << "," << statistics.num_misses
+                << "," << Aggregation::kName << "\n";
     }
   }
-}
\ No newline at end of file
+}
+
+// Calls f with std::type_identity of the aggregation that kernel names
+template <typename F>
+void DispatchKernel(std::string_view kernel, F &&f) {
+  if (kernel == HashAggregation::kName) {
+    f(std::type_identity<HashAggregation>{});
+  } else if (kernel == VectorizedAggregation::kName) {
+    f(std::type_identity<VectorizedAggregation>{});
+  } else {
+    throw std::invalid_argument{"Unknown kernel " + std::string{kernel}};
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 9 || argc > 11) {
+    std::cerr << "Usage: " << argv[0]
+              << " lineitem.dat num_threads num_entries_per_ring "
+                 "num_tuples_per_morsel do_work "
+                 "do_random_io print_result print_header "
+                 "[pax|compressed|columns] [hash|vectorized]\n";
+    return 1;
+  }
+
+  std::string path_to_lineitem{argv[1]};
+  unsigned num_threads = std::atoi(argv[2]);
+  unsigned num_entries_per_ring = std::atoi(argv[3]);
+  num_tuples_per_morsel = std::atoi(argv[4]);
+  std::istringstream(argv[5]) >> std::boolalpha >> do_work;
+  bool do_random_io;
+  std::istringstream(argv[6]) >> std::boolalpha >> do_random_io;
+  bool print_result;
+  std::istringstream(argv[7]) >> std::boolalpha >> print_result;
+  bool print_header;
+  std::istringstream(argv[8]) >> std::boolalpha >> print_header;
+
+  std::string_view storage = "pax";
+  if (argc >= 10) {
+    storage = argv[9];
+  }
+  if (storage != "pax" && storage != "compressed" && storage != "columns") {
+    std::cerr << "Unknown storage " << storage << "\n";
+    return 1;
+  }
+
+  std::string_view kernel = HashAggregation::kName;
+  if (argc == 11) {
+    kernel = argv[10];
+  }
+  if (kernel != HashAggregation::kName &&
+      kernel != VectorizedAggregation::kName) {
+    std::cerr << "Unknown kernel " << kernel << "\n";
+    return 1;
+  }
+
+  DispatchKernel(kernel, [&](auto aggregation) {
+    using Aggregation = typename decltype(aggregation)::type;
+    // the column files have no header, their row groups do not depend on the
+    // page size
+    if (storage == "columns") {
+      RunQuery<LineitemColumnsQ1, ColumnStore<LineitemColumnsQ1>, Aggregation>(
+          path_to_lineitem.c_str(), num_threads, num_entries_per_ring,
+          do_random_io, print_result, print_header);
+      return;
+    }
+
+    auto header = Catalog::ReadFor(path_to_lineitem.c_str()).GetHeader();
+    DispatchPageSize(header.page_size_power, [&](auto page_size) {
+      using Page = BasicLineitemPageQ1<decltype(page_size)::value>;
+      if (storage == "pax") {
+        RunQuery<Page, File, Aggregation>(
+            path_to_lineitem.c_str(), num_threads, num_entries_per_ring,
+            do_random_io, print_result, print_header);
+      } else {
+        RunQuery<CompressedPage<Page>, File, Aggregation>(
+            path_to_lineitem.c_str(), num_threads, num_entries_per_ring,
+            do_random_io, print_result, print_header);
+      }
+    });
+  });
+}
@@ -4,6 +4,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <bit>
 #include <cstdint>
@@ -11,8 +12,10 @@
 #include <exception>
 #include <iostream>
 #include <latch>
+#include <memory>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <span>
 #include <sstream>
 #include <string_view>
@@ -23,11 +26,16 @@
 #include "cppcoro/sync_wait.hpp"
 #include "cppcoro/task.hpp"
 #include "cppcoro/when_all_ready.hpp"
+#include "storage/catalog.h"
 #include "storage/file.h"
 #include "storage/io_uring.h"
+#include "storage/morsel_scheduler.h"
+#include "storage/numa.h"
 #include "storage/schema.h"
 #include "storage/swip.h"
 #include "storage/types.h"
+#include "storage/worker_pool.h"
+#include "storage/zone_map.h"
 
 namespace {
 using namespace storage;
@@ -142,6 +150,8 @@ class LineitemHashTable {
   uint64_t hash_table_mask_;
 };
 
+// Page is a page type of part that contains p_partkey and p_type
+template <typename Page>
 class PartHashTable {
  public:
   PartHashTable(unsigned thread_count, unsigned total_num_pages)
@@ -156,7 +166,7 @@ class PartHashTable {
     }
   }
 
-  void InsertLocalEntries(const PartPage *begin, const PartPage *end,
+  void InsertLocalEntries(const Page *begin, const Page *end,
                           PageIndex begin_page_index, unsigned thread_index,
                           const LineitemHashTable &lineitem_hash_table) {
     auto &entries = thread_local_entries_[thread_index];
@@ -166,7 +176,7 @@ class PartHashTable {
       uint32_t num_references = 0u;
       for (uint32_t i = 0, num_tuples = iter->num_tuples; i != num_tuples;
            ++i) {
-        auto partkey = iter->p_partkey[i];
+        auto partkey = iter->p_partkey()[i];
         if (auto count = lineitem_hash_table.LookupCountForPartkey(partkey);
             count > 0) {
           entries.emplace_back(swips_[current_page_index], partkey, i);
@@ -224,13 +234,6 @@ class PartHashTable {
 
   void CacheAtLeastNumReferences(File &part_data_file,
                                  uint64_t num_references_to_be_cached) {
-    constexpr uint64_t kNumConcurrentTasks = 64ull;
-    IOUring ring(kNumConcurrentTasks);
-    Countdown countdown(kNumConcurrentTasks);
-
-    std::vector<cppcoro::task<void>> tasks;
-    tasks.reserve(kNumConcurrentTasks + 1);
-
     auto global_begin = num_used_buffer_pages_;
 
     auto num_swips = swips_.size();
@@ -245,6 +248,39 @@ class PartHashTable {
 
     auto global_end = num_used_buffer_pages_;
 
+    // Every NUMA node loads its share of the pages into frames that are local
+    // to that node
+    const auto &nodes = GetNumaNodes();
+    auto num_pages = global_end - global_begin;
+    uint64_t partition_size = (num_pages + nodes.size() - 1) / nodes.size();
+
+    std::vector<std::thread> threads;
+    threads.reserve(nodes.size());
+
+    for (uint64_t i = 0; i != nodes.size(); ++i) {
+      uint64_t begin = std::min(global_begin + i * partition_size, global_end);
+      auto end = std::min(begin + partition_size, global_end);
+      threads.emplace_back(
+          [this, node = nodes[i], begin, end, &part_data_file] {
+            BindCurrentThreadToNumaNode(node);
+            CacheLocalPages(begin, end, node, part_data_file);
+          });
+    }
+
+    for (auto &t : threads) {
+      t.join();
+    }
+  }
+
+  void CacheLocalPages(uint64_t global_begin, uint64_t global_end,
+                       NumaNode node, File &part_data_file) {
+    constexpr uint64_t kNumConcurrentTasks = 64ull;
+    IOUring ring(kNumConcurrentTasks);
+    Countdown countdown(kNumConcurrentTasks);
+
+    std::vector<cppcoro::task<void>> tasks;
+    tasks.reserve(kNumConcurrentTasks + 1);
+
     auto num_pages = global_end - global_begin;
     uint64_t partition_size =
         (num_pages + kNumConcurrentTasks - 1) / kNumConcurrentTasks;
@@ -252,7 +288,7 @@ class PartHashTable {
       uint64_t begin = std::min(global_begin + i * partition_size, global_end);
       auto end = std::min(begin + partition_size, global_end);
       tasks.emplace_back(
-          AsyncLoadPages(ring, begin, end, countdown, part_data_file));
+          AsyncLoadPages(ring, begin, end, countdown, part_data_file, node));
     }
     tasks.emplace_back(DrainRing(ring, countdown));
     cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
@@ -260,15 +296,19 @@ class PartHashTable {
 
   cppcoro::task<void> AsyncLoadPages(IOUring &ring, uint64_t begin,
                                      uint64_t end, Countdown &countdown,
-                                     File &part_data_file) {
+                                     File &part_data_file, NumaNode node) {
     for (uint64_t i = begin; i != end; ++i) {
-      auto *page = reinterpret_cast<std::byte *>(&part_pages_buffer_[i]);
+      Page *page = part_pages_buffer_.Allocate(node);
       co_await part_data_file.AsyncReadPage(ring, i, page);
       swips_[i].SetPointer(page);
     }
     countdown.Decrement();
   }
 
+  NumaNode GetNumaNode(const Page *page) const noexcept {
+    return part_pages_buffer_.GetNode(page);
+  }
+
   uint64_t GetNumAlreadyCachedReferences() const noexcept {
     return num_cached_references_;
   }
@@ -296,13 +336,14 @@ class PartHashTable {
   std::vector<Entry *> hash_table_;
   std::vector<PageReferences> page_references_;
   uint64_t hash_table_mask_;
-  std::vector<PartPage> part_pages_buffer_;
+  NumaFramePool<Page> part_pages_buffer_;
   uint64_t num_used_buffer_pages_;
   uint64_t num_cached_references_;
 };
 
-PartHashTable BuildHashTableForPart(const InMemoryLineitemData &lineitem_data,
-                                    const char *path_to_part) {
+template <typename Page>
+PartHashTable<Page> BuildHashTableForPart(
+    const InMemoryLineitemData &lineitem_data, const char *path_to_part) {
   unsigned thread_count = std::thread::hardware_concurrency();
 
   // First, we build a hash table on lineitem after applying the predicate used
@@ -350,12 +391,13 @@ PartHashTable BuildHashTableForPart(const InMemoryLineitemData &lineitem_data,
   // will be accessed for processing query 14.
   int fd = open(path_to_part, O_RDONLY);
   uint64_t size_in_bytes = lseek(fd, 0, SEEK_END);
-  auto *data = reinterpret_cast<PartPage *>(
+  auto *file_data = static_cast<std::byte *>(
       mmap(nullptr, size_in_bytes, PROT_READ, MAP_SHARED, fd, 0));
-  madvise(data, size_in_bytes, MADV_SEQUENTIAL);
-  madvise(data, size_in_bytes, MADV_WILLNEED);
+  madvise(file_data, size_in_bytes, MADV_SEQUENTIAL);
+  madvise(file_data, size_in_bytes, MADV_WILLNEED);
+  auto *data = reinterpret_cast<const Page *>(file_data + kDataFileHeaderSize);
 
-  auto total_num_pages = size_in_bytes / kPageSize;
+  auto total_num_pages = Catalog::ReadFor<Page>(path_to_part).GetNumPages();
   auto num_pages_per_thread =
       (total_num_pages + thread_count - 1) / thread_count;
   std::vector<std::thread> threads;
@@ -364,7 +406,7 @@ PartHashTable BuildHashTableForPart(const InMemoryLineitemData &lineitem_data,
   std::once_flag flag;
   std::latch latch{thread_count};
 
-  PartHashTable part_hash_table(thread_count, total_num_pages);
+  PartHashTable<Page> part_hash_table(thread_count, total_num_pages);
 
   for (unsigned thread_index = 0; thread_index != thread_count;
        ++thread_index) {
@@ -390,114 +432,104 @@ PartHashTable BuildHashTableForPart(const InMemoryLineitemData &lineitem_data,
   return part_hash_table;
 }
 
+template <typename Page>
 class QueryRunner {
  public:
-  QueryRunner(const PartHashTable &part_hash_table, File &part_data_file,
-              const InMemoryLineitemData &lineitem_data, unsigned thread_count,
-              uint32_t num_ring_entries = 0)
+  // With batched_probe, the probes of pages that are not cached are grouped by
+  // page, see ProcessLineitemsBatched. The rings of the workers need
+  // num_ring_entries entries.
+  QueryRunner(const PartHashTable<Page> &part_hash_table, File &part_data_file,
+              const InMemoryLineitemData &lineitem_data, WorkerPool &workers,
+              bool batched_probe, uint32_t num_ring_entries = 0)
       : part_hash_table_(part_hash_table),
         part_data_file_(part_data_file),
         lineitem_data_(lineitem_data),
-        thread_count_(thread_count),
-        thread_local_sums_(thread_count),
+        workers_(workers),
+        thread_local_sums_(workers.GetNumThreads()),
+        thread_local_numa_statistics_(workers.GetNumThreads()),
+        thread_local_num_page_reads_(workers.GetNumThreads()),
         lower_date_boundary(Date::FromString("1995-09-01|", '|').value),
         upper_date_boundary(Date::FromString("1995-09-30|", '|').value),
-        num_ring_entries_(num_ring_entries) {
-    if (num_ring_entries_ > 0) {
-      thread_local_rings_.reserve(thread_count_);
-      for (unsigned i = 0; i != thread_count; ++i) {
-        thread_local_rings_.emplace_back(num_ring_entries_);
-      }
-    }
-  }
+        batched_probe_(batched_probe),
+        num_ring_entries_(num_ring_entries) {}
 
   void StartProcessing(uint64_t num_tuples_per_coroutine = 0) {
-    std::atomic<uint64_t> current_lineitem_tuple_offset{0ull};
-    std::vector<std::thread> threads;
-    threads.reserve(thread_count_);
-
-    for (unsigned thread_index = 0; thread_index != thread_count_;
-         ++thread_index) {
-      threads.emplace_back([is_synchronous = IsSynchronous(),
-                            num_coroutines = num_ring_entries_,
-                            &current_lineitem_tuple_offset,
-                            total_num_tuples_lineitem =
-                                lineitem_data_.GetSize(),
-                            this, thread_index,
-                            &ring = thread_local_rings_[thread_index],
-                            num_tuples_per_coroutine] {
-        std::vector<cppcoro::task<void>> tasks;
-        if (!is_synchronous) {
-          cppcoro::detail::allocator = new Allocator(num_coroutines);
-          cppcoro::detail::sync_allocator = new Allocator(1);
-        }
-        std::allocator<PartPage> alloc;
-        auto part_pages_buffer =
-            alloc.allocate(is_synchronous ? 1 : num_coroutines);
-
-        uint64_t fetch_increment =
-            is_synchronous ? 100'000ull
-                           : std::max(num_coroutines * num_tuples_per_coroutine,
-                                      100'000ul);
-        while (true) {
-          uint64_t begin =
-              current_lineitem_tuple_offset.fetch_add(fetch_increment);
-          if (begin >= total_num_tuples_lineitem) {
-            return;
-          }
-          auto end =
-              std::min(begin + fetch_increment, total_num_tuples_lineitem);
-
-          if (is_synchronous) {
-            ProcessLineitems(begin, end, part_pages_buffer[0], thread_index);
-          } else {
-            Countdown countdown(0);
-            auto local_begin = begin;
-            auto local_end = local_begin + num_tuples_per_coroutine;
-            for (; local_end <= end; local_begin = local_end,
-                                     local_end += num_tuples_per_coroutine) {
-              tasks.emplace_back(AsyncProcessLineitems(
-                  local_begin, local_end, part_pages_buffer[tasks.size()],
-                  thread_index, ring, countdown));
-
-              if (tasks.size() == num_coroutines) {
-                countdown.Set(num_coroutines);
-                tasks.emplace_back(DrainRing(ring, countdown));
-                cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
-              }
-            }
-            if (tasks.empty()) {
-              ProcessLineitems(local_begin, end, part_pages_buffer[0],
-                               thread_index);
-            } else {
-              tasks.emplace_back(AsyncProcessLineitems(
-                  local_begin, end, part_pages_buffer[tasks.size()],
-                  thread_index, ring, countdown));
-              countdown.Set(tasks.size());
+    uint64_t num_tuples_per_morsel =
+        IsSynchronous() ? 100'000ull
+                        : std::max(num_ring_entries_ * num_tuples_per_coroutine,
+                                   100'000ul);
+    MorselScheduler scheduler{lineitem_data_.GetSize(),
+                              workers_.GetNumThreads(), num_tuples_per_morsel};
+
+    workers_.Run([this, &scheduler, num_tuples_per_coroutine](Worker &worker) {
+      auto thread_index = worker.GetIndex();
+      bool is_synchronous = IsSynchronous();
+      auto num_coroutines = num_ring_entries_;
+      std::vector<cppcoro::task<void>> tasks;
+      std::vector<PendingProbe> batch;
+      auto *part_pages_buffer =
+          worker.GetPages<Page>(is_synchronous ? 1 : num_coroutines);
+
+      while (auto morsel = scheduler.Next(thread_index)) {
+        auto [begin, end] = *morsel;
+
+        if (batched_probe_) {
+          ProcessLineitemsBatched(begin, end, part_pages_buffer, thread_index,
+                                  is_synchronous ? nullptr : worker.GetRing(),
+                                  batch);
+        } else if (is_synchronous) {
+          ProcessLineitems(begin, end, part_pages_buffer[0], thread_index);
+        } else {
+          auto &ring = *worker.GetRing();
+          Countdown countdown(0);
+          auto local_begin = begin;
+          auto local_end = local_begin + num_tuples_per_coroutine;
+          for (; local_end <= end; local_begin = local_end,
+                                   local_end += num_tuples_per_coroutine) {
+            tasks.emplace_back(AsyncProcessLineitems(
+                local_begin, local_end, part_pages_buffer[tasks.size()],
+                thread_index, ring, countdown));
+
+            if (tasks.size() == num_coroutines) {
+              countdown.Set(num_coroutines);
               tasks.emplace_back(DrainRing(ring, countdown));
               cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
             }
           }
+          if (tasks.empty()) {
+            ProcessLineitems(local_begin, end, part_pages_buffer[0],
+                             thread_index);
+          } else {
+            tasks.emplace_back(AsyncProcessLineitems(
+                local_begin, end, part_pages_buffer[tasks.size()],
+                thread_index, ring, countdown));
+            countdown.Set(tasks.size());
+            tasks.emplace_back(DrainRing(ring, countdown));
+            cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
+          }
         }
-        alloc.deallocate(part_pages_buffer,
-                         is_synchronous ? 1 : num_coroutines);
-        if (!is_synchronous) {
-          delete cppcoro::detail::allocator;
-          cppcoro::detail::allocator = nullptr;
-          delete cppcoro::detail::sync_allocator;
-          cppcoro::detail::sync_allocator = nullptr;
-        }
-      });
-    }
+      }
+    });
+  }
 
-    for (auto &t : threads) {
-      t.join();
+  NumaStatistics GetNumaStatistics() const noexcept {
+    NumaStatistics result;
+    for (const auto &statistics : thread_local_numa_statistics_) {
+      result += statistics;
     }
+    return result;
+  }
+
+  // The number of part pages that were read. Without batched_probe, every miss
+  // reads a page.
+  uint64_t GetNumPageReads() const noexcept {
+    return std::accumulate(thread_local_num_page_reads_.begin(),
+                           thread_local_num_page_reads_.end(), uint64_t{0});
   }
 
   void DoPostProcessing(bool should_print_result) const {
-    Numeric<12, 4> first_sum;
-    Numeric<12, 4> second_sum;
+    NumericSum<12, 4> first_sum;
+    NumericSum<12, 4> second_sum;
     for (const auto &local_sums : thread_local_sums_) {
       first_sum += local_sums.first;
       second_sum += local_sums.second;
@@ -512,10 +544,152 @@ class QueryRunner {
   }
 
  private:
+  // A page that is not cached is only probed for p_type, so the misses read
+  // just the bytes of that column
+  static constexpr size_t kPartTypeColumnIndex = Page::IndexOf("p_type");
+
+  using NumericsPair = std::pair<NumericSum<12, 4>, NumericSum<12, 4>>;
+
+  // The probe of a qualifying lineitem tuple whose part page is not cached
+  struct PendingProbe {
+    PageIndex page_index;
+    uint32_t part_tuple_offset;
+    uint64_t lineitem_tuple_offset;
+  };
+
+  // Adds the revenue of the lineitem tuple to sums.second and, if its part is
+  // a promotion, to sums.first
+  void AddRevenue(uint64_t tuple_offset, const Page &part_page,
+                  uint32_t part_tuple_offset, NumericsPair &sums) const {
+    auto sum =
+        lineitem_data_.l_extendedprice[tuple_offset] *
+        (Numeric<12, 2>{100ll} - lineitem_data_.l_discount[tuple_offset]);
+    std::string_view p_type(part_page.p_type()[part_tuple_offset].Begin(),
+                            part_page.p_type()[part_tuple_offset].Size());
+    if (p_type.starts_with("PROMO")) {
+      sums.first += sum;
+    }
+    sums.second += sum;
+  }
+
+  // Probes the qualifying tuples in [begin_tuple_offset, end_tuple_offset).
+  // The probes of cached pages are processed right away, the others are
+  // appended to batch, sorted by page.
+  void CollectProbes(uint64_t begin_tuple_offset, uint64_t end_tuple_offset,
+                     std::vector<PendingProbe> &batch, NumaNode node,
+                     NumericsPair &sums, NumaStatistics &statistics) const {
+    for (auto tuple_offset = begin_tuple_offset;
+         tuple_offset != end_tuple_offset; ++tuple_offset) {
+      if (lower_date_boundary <= lineitem_data_.l_shipdate[tuple_offset] &&
+          lineitem_data_.l_shipdate[tuple_offset] <= upper_date_boundary) {
+        auto lookup_result = part_hash_table_.LookupPartkey(
+            lineitem_data_.l_partkey[tuple_offset]);
+
+        if (lookup_result.swip.IsPageIndex()) {
+          ++statistics.num_misses;
+          batch.push_back({lookup_result.swip.GetPageIndex(),
+                           lookup_result.tuple_offset, tuple_offset});
+        } else {
+          const auto *part_page =
+              lookup_result.swip.template GetPointer<const Page>();
+          if (part_hash_table_.GetNumaNode(part_page) == node) {
+            ++statistics.num_local_hits;
+          } else {
+            ++statistics.num_remote_hits;
+          }
+          AddRevenue(tuple_offset, *part_page, lookup_result.tuple_offset,
+                     sums);
+        }
+      }
+    }
+
+    // the probes of a page become adjacent, so every page is read once
+    std::sort(batch.begin(), batch.end(),
+              [](const PendingProbe &lhs, const PendingProbe &rhs) {
+                return lhs.page_index < rhs.page_index;
+              });
+  }
+
+  // Like ProcessLineitems, but collects the probes of pages that are not
+  // cached for the whole morsel in batch and reads every distinct page only
+  // once. The distinct pages are split into consecutive ranges, one for each
+  // buffer, which are read with the ring, or synchronously if it is nullptr.
+  void ProcessLineitemsBatched(uint64_t begin_tuple_offset,
+                               uint64_t end_tuple_offset, Page *buffers,
+                               unsigned thread_index, IOUring *ring,
+                               std::vector<PendingProbe> &batch) {
+    NumericsPair sums;
+    NumaStatistics statistics;
+    batch.clear();
+    CollectProbes(begin_tuple_offset, end_tuple_offset, batch,
+                  GetNumaNodeOfThread(thread_index), sums, statistics);
+
+    // the offsets of the first probes of the distinct pages and the end
+    std::vector<size_t> page_offsets;
+    for (size_t i = 0; i != batch.size(); ++i) {
+      if (i == 0 || batch[i].page_index != batch[i - 1].page_index) {
+        page_offsets.push_back(i);
+      }
+    }
+    size_t num_pages = page_offsets.size();
+    page_offsets.push_back(batch.size());
+
+    size_t num_coroutines = ring == nullptr ? 1 : num_ring_entries_;
+    size_t num_pages_per_coroutine =
+        (num_pages + num_coroutines - 1) / num_coroutines;
+    std::vector<cppcoro::task<void>> tasks;
+    Countdown countdown(0);
+    for (size_t first_page = 0; first_page < num_pages;
+         first_page += num_pages_per_coroutine) {
+      auto last_page =
+          std::min(first_page + num_pages_per_coroutine, num_pages);
+      std::span<const PendingProbe> probes(
+          batch.data() + page_offsets[first_page],
+          batch.data() + page_offsets[last_page]);
+      tasks.emplace_back(
+          ProbePages(probes, buffers[tasks.size()], ring, sums, countdown));
+    }
+    countdown.Set(tasks.size());
+    if (ring != nullptr && !tasks.empty()) {
+      tasks.emplace_back(DrainRing(*ring, countdown));
+    }
+    cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
+
+    thread_local_sums_[thread_index].first += sums.first;
+    thread_local_sums_[thread_index].second += sums.second;
+    thread_local_numa_statistics_[thread_index] += statistics;
+    thread_local_num_page_reads_[thread_index] += num_pages;
+  }
+
+  // Reads the page of every run of probes with the same page_index into
+  // buffer, with the ring or synchronously if it is nullptr, and processes
+  // the probes of the run
+  cppcoro::task<void> ProbePages(std::span<const PendingProbe> probes,
+                                 Page &buffer, IOUring *ring,
+                                 NumericsPair &sums, Countdown &countdown) {
+    auto *data = reinterpret_cast<std::byte *>(&buffer);
+    for (auto iter = probes.begin(); iter != probes.end();) {
+      auto page_index = iter->page_index;
+      if (ring == nullptr) {
+        part_data_file_.ReadColumns<Page, kPartTypeColumnIndex>(page_index,
+                                                                data);
+      } else {
+        co_await part_data_file_.AsyncReadColumns<Page, kPartTypeColumnIndex>(
+            *ring, page_index, data);
+      }
+      for (; iter != probes.end() && iter->page_index == page_index; ++iter) {
+        AddRevenue(iter->lineitem_tuple_offset, buffer,
+                   iter->part_tuple_offset, sums);
+      }
+    }
+    countdown.Decrement();
+  }
+
   void ProcessLineitems(uint64_t begin_tuple_offset, uint64_t end_tuple_offset,
-                        PartPage &buffer, unsigned thread_index) {
-    Numeric<12, 4> first_sum;
-    Numeric<12, 4> second_sum;
+                        Page &buffer, unsigned thread_index) {
+    NumericsPair sums;
+    NumaStatistics statistics;
+    auto node = GetNumaNodeOfThread(thread_index);
     for (auto tuple_offset = begin_tuple_offset;
          tuple_offset != end_tuple_offset; ++tuple_offset) {
       if (lower_date_boundary <= lineitem_data_.l_shipdate[tuple_offset] &&
@@ -523,36 +697,40 @@ class QueryRunner {
         auto lookup_result = part_hash_table_.LookupPartkey(
             lineitem_data_.l_partkey[tuple_offset]);
 
-        const PartPage *part_page;
+        const Page *part_page;
         if (lookup_result.swip.IsPageIndex()) {
-          part_data_file_.ReadPage(lookup_result.swip.GetPageIndex(),
-                                   reinterpret_cast<std::byte *>(&buffer));
+          ++statistics.num_misses;
+          part_data_file_.ReadColumns<Page, kPartTypeColumnIndex>(
+              lookup_result.swip.GetPageIndex(),
+              reinterpret_cast<std::byte *>(&buffer));
           part_page = &buffer;
         } else {
-          part_page = lookup_result.swip.GetPointer<const PartPage>();
+          part_page = lookup_result.swip.template GetPointer<const Page>();
+          if (part_hash_table_.GetNumaNode(part_page) == node) {
+            ++statistics.num_local_hits;
+          } else {
+            ++statistics.num_remote_hits;
+          }
         }
 
-        auto sum =
-            lineitem_data_.l_extendedprice[tuple_offset] *
-            (Numeric<12, 2>{100ll} - lineitem_data_.l_discount[tuple_offset]);
-        std::string_view p_type(
-            part_page->p_type[lookup_result.tuple_offset].Begin(),
-            part_page->p_type[lookup_result.tuple_offset].Size());
-        if (p_type.starts_with("PROMO")) {
-          first_sum += sum;
-        }
-        second_sum += sum;
+        AddRevenue(tuple_offset, *part_page, lookup_result.tuple_offset, sums);
       }
     }
-    thread_local_sums_[thread_index].first += first_sum;
-    thread_local_sums_[thread_index].second += second_sum;
+    thread_local_sums_[thread_index].first += sums.first;
+    thread_local_sums_[thread_index].second += sums.second;
+    thread_local_numa_statistics_[thread_index] += statistics;
+    thread_local_num_page_reads_[thread_index] += statistics.num_misses;
   }
 
-  cppcoro::task<void> AsyncProcessLineitems(
-      uint64_t begin_tuple_offset, uint64_t end_tuple_offset, PartPage &buffer,
-      unsigned thread_index, IOUring &ring, Countdown &countdown) {
-    Numeric<12, 4> first_sum;
-    Numeric<12, 4> second_sum;
+  cppcoro::task<void> AsyncProcessLineitems(uint64_t begin_tuple_offset,
+                                            uint64_t end_tuple_offset,
+                                            Page &buffer,
+                                            unsigned thread_index,
+                                            IOUring &ring,
+                                            Countdown &countdown) {
+    NumericsPair sums;
+    NumaStatistics statistics;
+    auto node = GetNumaNodeOfThread(thread_index);
     for (auto tuple_offset = begin_tuple_offset;
          tuple_offset != end_tuple_offset; ++tuple_offset) {
       if (lower_date_boundary <= lineitem_data_.l_shipdate[tuple_offset] &&
@@ -560,58 +738,90 @@ class QueryRunner {
         auto lookup_result = part_hash_table_.LookupPartkey(
             lineitem_data_.l_partkey[tuple_offset]);
 
-        const PartPage *part_page;
+        const Page *part_page;
         if (lookup_result.swip.IsPageIndex()) {
-          co_await part_data_file_.AsyncReadPage(
+          ++statistics.num_misses;
+          co_await part_data_file_.AsyncReadColumns<Page, kPartTypeColumnIndex>(
               ring, lookup_result.swip.GetPageIndex(),
               reinterpret_cast<std::byte *>(&buffer));
           part_page = &buffer;
         } else {
-          part_page = lookup_result.swip.GetPointer<const PartPage>();
+          part_page = lookup_result.swip.template GetPointer<const Page>();
+          if (part_hash_table_.GetNumaNode(part_page) == node) {
+            ++statistics.num_local_hits;
+          } else {
+            ++statistics.num_remote_hits;
+          }
         }
 
-        auto sum =
-            lineitem_data_.l_extendedprice[tuple_offset] *
-            (Numeric<12, 2>{100ll} - lineitem_data_.l_discount[tuple_offset]);
-        std::string_view p_type(
-            part_page->p_type[lookup_result.tuple_offset].Begin(),
-            part_page->p_type[lookup_result.tuple_offset].Size());
-        if (p_type.starts_with("PROMO")) {
-          first_sum += sum;
-        }
-        second_sum += sum;
+        AddRevenue(tuple_offset, *part_page, lookup_result.tuple_offset, sums);
       }
     }
-    thread_local_sums_[thread_index].first += first_sum;
-    thread_local_sums_[thread_index].second += second_sum;
+    thread_local_sums_[thread_index].first += sums.first;
+    thread_local_sums_[thread_index].second += sums.second;
+    thread_local_numa_statistics_[thread_index] += statistics;
+    thread_local_num_page_reads_[thread_index] += statistics.num_misses;
     countdown.Decrement();
   }
 
   bool IsSynchronous() const noexcept { return num_ring_entries_ == 0; }
 
-  using NumericsPair = std::pair<Numeric<12, 4>, Numeric<12, 4>>;
+  // The node that the worker with the index is bound to
+  static NumaNode GetNumaNodeOfThread(unsigned thread_index) {
+    const auto &nodes = GetNumaNodes();
+    return nodes[thread_index % nodes.size()];
+  }
 
-  const PartHashTable &part_hash_table_;
+  const PartHashTable<Page> &part_hash_table_;
   File &part_data_file_;
   const InMemoryLineitemData &lineitem_data_;
-  const uint32_t thread_count_;
+  WorkerPool &workers_;
   std::vector<NumericsPair> thread_local_sums_;
+  std::vector<NumaStatistics> thread_local_numa_statistics_;
+  std::vector<uint64_t> thread_local_num_page_reads_;
   const Date lower_date_boundary;
   const Date upper_date_boundary;
-  std::vector<IOUring> thread_local_rings_;
+  const bool batched_probe_;
   const uint32_t num_ring_entries_;
 };
 
+// Returns the number of tuples on the pages of lineitem that the zone map does
+// not rule out for the shipdate range of query 14
+template <typename Page>
+uint64_t CountCandidateTuples(const Catalog &catalog,
+                              const ZoneMap &zone_map) {
+  constexpr size_t kShipdateColumnIndex = Page::IndexOf("l_shipdate");
+  auto lower_date_boundary = Date::FromString("1995-09-01|", '|').value;
+  auto upper_date_boundary = Date::FromString("1995-09-30|", '|').value;
+  uint64_t num_tuples = 0;
+  for (PageIndex i = 0; i != catalog.GetNumPages(); ++i) {
+    if (zone_map.Match(i, kShipdateColumnIndex, lower_date_boundary,
+                       upper_date_boundary) != ZoneMatch::kNone) {
+      num_tuples += catalog.GetNumTuples(i);
+    }
+  }
+  return num_tuples;
+}
+
+// Page is a page type of lineitem that contains the columns of query 14
+template <typename Page>
 InMemoryLineitemData LoadLineitemRelation(const char *path_to_lineitem) {
   int fd = open(path_to_lineitem, O_RDONLY);
   uint64_t size_in_bytes = lseek(fd, 0, SEEK_END);
-  auto *data = reinterpret_cast<LineitemPageQ14 *>(
+  auto *file_data = static_cast<std::byte *>(
       mmap(nullptr, size_in_bytes, PROT_READ, MAP_SHARED, fd, 0));
+  auto *data = reinterpret_cast<const Page *>(file_data + kDataFileHeaderSize);
+
+  auto catalog = Catalog::ReadFor<Page>(path_to_lineitem);
+  auto total_num_pages = catalog.GetNumPages();
 
-  auto total_num_pages = size_in_bytes / kPageSize;
-  auto max_num_tuples = total_num_pages * LineitemPageQ14::kMaxNumTuples;
+  // pages without a single tuple in the shipdate range of query 14 are never
+  // touched and therefore never read
+  auto zone_map =
+      ZoneMap::ReadFor(path_to_lineitem, Page::kNumColumns);
 
-  InMemoryLineitemData result(max_num_tuples);
+  // exactly the tuples of the pages that are read
+  InMemoryLineitemData result(CountCandidateTuples<Page>(catalog, zone_map));
   auto num_threads = std::thread::hardware_concurrency();
   auto num_pages_per_thread = (total_num_pages + num_threads - 1) / num_threads;
 
@@ -619,26 +829,36 @@ InMemoryLineitemData LoadLineitemRelation(const char *path_to_lineitem) {
   threads.reserve(num_threads);
   for (unsigned thread_index = 0; thread_index != num_threads; ++thread_index) {
     threads.emplace_back(
-        [thread_index, num_pages_per_thread, total_num_pages, &result, data]() {
+        [thread_index, num_pages_per_thread, total_num_pages, &result, data,
+         &zone_map]() {
+          constexpr size_t kShipdateColumnIndex =
+              Page::IndexOf("l_shipdate");
+          auto lower_date_boundary = Date::FromString("1995-09-01|", '|').value;
+          auto upper_date_boundary = Date::FromString("1995-09-30|", '|').value;
           auto begin =
               std::min(thread_index * num_pages_per_thread, total_num_pages);
           auto end = std::min(begin + num_pages_per_thread, total_num_pages);
           for (auto page_index = begin; page_index != end; ++page_index) {
-            const LineitemPageQ14 &page = data[page_index];
+            if (zone_map.Match(page_index, kShipdateColumnIndex,
+                               lower_date_boundary,
+                               upper_date_boundary) == ZoneMatch::kNone) {
+              continue;
+            }
+            const Page &page = data[page_index];
             auto num_tuples = page.num_tuples;
             auto first_tuple_offset = result.IncreaseSize(num_tuples);
             std::memcpy(&result.l_partkey[first_tuple_offset],
-                        &page.l_partkey.front(),
-                        sizeof(page.l_partkey.front()) * num_tuples);
+                        page.l_partkey().data(),
+                        sizeof(page.l_partkey().front()) * num_tuples);
             std::memcpy(&result.l_extendedprice[first_tuple_offset],
-                        &page.l_extendedprice.front(),
-                        sizeof(page.l_extendedprice.front()) * num_tuples);
+                        page.l_extendedprice().data(),
+                        sizeof(page.l_extendedprice().front()) * num_tuples);
             std::memcpy(&result.l_discount[first_tuple_offset],
-                        &page.l_discount.front(),
-                        sizeof(page.l_discount.front()) * num_tuples);
+                        page.l_discount().data(),
+                        sizeof(page.l_discount().front()) * num_tuples);
             std::memcpy(&result.l_shipdate[first_tuple_offset],
-                        &page.l_shipdate.front(),
-                        sizeof(page.l_shipdate.front()) * num_tuples);
+                        page.l_shipdate().data(),
+                        sizeof(page.l_shipdate().front()) * num_tuples);
           }
         });
   }
@@ -647,46 +867,172 @@ InMemoryLineitemData LoadLineitemRelation(const char *path_to_lineitem) {
   }
   return result;
 }
-}  // namespace
 
-int main(int argc, char *argv[]) {
-  if (argc != 8) {
-    std::cerr << "Usage: " << argv[0]
-              << " lineitem.dat part.dat num_threads num_entries_per_ring "
-                 "num_tuples_per_coroutine "
-                 "print_result print_header\n";
-    return 1;
+// Reads the l_shipdate column of the pages in [begin, end) and then the
+// other columns only of the pages with at least one tuple in the shipdate
+// range of query 14. Only the qualifying tuples are appended to result.
+template <typename Page>
+cppcoro::task<void> AsyncLoadQualifyingLineitems(
+    IOUring &ring, const File &file, const ZoneMap &zone_map, PageIndex begin,
+    PageIndex end, Page &buffer, InMemoryLineitemData &result,
+    Countdown &countdown) {
+  constexpr size_t kPartkeyColumnIndex = Page::IndexOf("l_partkey");
+  constexpr size_t kExtendedpriceColumnIndex =
+      Page::IndexOf("l_extendedprice");
+  constexpr size_t kDiscountColumnIndex =
+      Page::IndexOf("l_discount");
+  constexpr size_t kShipdateColumnIndex =
+      Page::IndexOf("l_shipdate");
+  auto lower_date_boundary = Date::FromString("1995-09-01|", '|').value;
+  auto upper_date_boundary = Date::FromString("1995-09-30|", '|').value;
+
+  std::vector<uint32_t> qualifying;
+  qualifying.reserve(Page::kMaxNumTuples);
+  auto *data = reinterpret_cast<std::byte *>(&buffer);
+
+  for (auto page_index = begin; page_index != end; ++page_index) {
+    if (zone_map.Match(page_index, kShipdateColumnIndex, lower_date_boundary,
+                       upper_date_boundary) == ZoneMatch::kNone) {
+      continue;
+    }
+
+    co_await file.AsyncReadColumns<Page, kShipdateColumnIndex>(
+        ring, page_index, data);
+    qualifying.clear();
+    auto l_shipdate = buffer.l_shipdate();
+    for (uint32_t i = 0, num_tuples = buffer.num_tuples; i != num_tuples;
+         ++i) {
+      if (lower_date_boundary <= l_shipdate[i] &&
+          l_shipdate[i] <= upper_date_boundary) {
+        qualifying.push_back(i);
+      }
+    }
+    if (qualifying.empty()) {
+      continue;
+    }
+
+    co_await file.AsyncReadColumns<Page, kPartkeyColumnIndex,
+                                   kExtendedpriceColumnIndex,
+                                   kDiscountColumnIndex>(ring, page_index,
+                                                         data);
+    auto first_tuple_offset = result.IncreaseSize(qualifying.size());
+    for (auto tuple_index : qualifying) {
+      result.l_partkey[first_tuple_offset] = buffer.l_partkey()[tuple_index];
+      result.l_extendedprice[first_tuple_offset] =
+          buffer.l_extendedprice()[tuple_index];
+      result.l_discount[first_tuple_offset] = buffer.l_discount()[tuple_index];
+      result.l_shipdate[first_tuple_offset] = l_shipdate[tuple_index];
+      ++first_tuple_offset;
+    }
   }
+  countdown.Decrement();
+}
 
-  const char *path_to_lineitem = argv[1];
-  const char *path_to_part = argv[2];
-  unsigned num_threads = std::atoi(argv[3]);
-  unsigned num_entries_per_ring = std::atoi(argv[4]);
-  unsigned num_tuples_per_coroutine = std::atoi(argv[5]);
-  bool print_result;
-  std::istringstream(argv[6]) >> std::boolalpha >> print_result;
-  bool print_header;
-  std::istringstream(argv[7]) >> std::boolalpha >> print_header;
+// Loads lineitem with late materialization: the payload columns of a page are
+// only read if the page contains a tuple that satisfies the predicate on
+// l_shipdate, so the amount of I/O follows the selectivity of the predicate
+template <typename Page>
+InMemoryLineitemData LoadQualifyingLineitems(const char *path_to_lineitem) {
+  constexpr unsigned kNumConcurrentTasks = 16;
+  const File file{path_to_lineitem, File::kRead, true};
+  auto catalog = Catalog::ReadFor<Page>(path_to_lineitem);
+  auto total_num_pages = catalog.GetNumPages();
+  auto zone_map =
+      ZoneMap::ReadFor(path_to_lineitem, Page::kNumColumns);
+
+  // the qualifying tuples are a subset of the tuples of the candidate pages
+  InMemoryLineitemData result(CountCandidateTuples<Page>(catalog, zone_map));
+  auto num_threads = std::thread::hardware_concurrency();
+  auto num_pages_per_thread = (total_num_pages + num_threads - 1) / num_threads;
 
-  InMemoryLineitemData lineitem_data = LoadLineitemRelation(path_to_lineitem);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (unsigned thread_index = 0; thread_index != num_threads; ++thread_index) {
+    threads.emplace_back([thread_index, num_pages_per_thread, total_num_pages,
+                          &result, &file, &zone_map]() {
+      auto thread_begin =
+          std::min(thread_index * num_pages_per_thread, total_num_pages);
+      auto thread_end =
+          std::min(thread_begin + num_pages_per_thread, total_num_pages);
+      auto num_pages = thread_end - thread_begin;
+      uint64_t partition_size =
+          (num_pages + kNumConcurrentTasks - 1) / kNumConcurrentTasks;
+
+      // every task awaits one read at a time, which submits one entry per
+      // block. The second read has up to four blocks: the number of tuples,
+      // l_partkey, l_extendedprice and l_discount.
+      constexpr unsigned kMaxNumEntriesPerTask = 4;
+      IOUring ring(kMaxNumEntriesPerTask * kNumConcurrentTasks);
+      Countdown countdown(kNumConcurrentTasks);
+      auto buffers = std::make_unique_for_overwrite<Page[]>(
+          kNumConcurrentTasks);
+
+      std::vector<cppcoro::task<void>> tasks;
+      tasks.reserve(kNumConcurrentTasks + 1);
+      for (unsigned i = 0; i != kNumConcurrentTasks; ++i) {
+        uint64_t begin =
+            std::min(thread_begin + i * partition_size, thread_end);
+        auto end = std::min(begin + partition_size, thread_end);
+        tasks.emplace_back(AsyncLoadQualifyingLineitems<Page>(
+            ring, file, zone_map, begin, end, buffers[i], result, countdown));
+      }
+      tasks.emplace_back(DrainRing(ring, countdown));
+      cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return result;
+}
+
+// Loads lineitem with the page type that matches the page size of its data
+// file. With late materialization, only the qualifying tuples are loaded.
+InMemoryLineitemData LoadLineitem(const char *path_to_lineitem,
+                                  size_t page_size_power,
+                                  bool late_materialization) {
+  std::optional<InMemoryLineitemData> lineitem_data;
+  DispatchPageSize(page_size_power, [&](auto page_size) {
+    using Page = BasicLineitemPageQ14<decltype(page_size)::value>;
+    lineitem_data.emplace(
+        late_materialization ? LoadQualifyingLineitems<Page>(path_to_lineitem)
+                             : LoadLineitemRelation<Page>(path_to_lineitem));
+  });
+  return std::move(*lineitem_data);
+}
 
-  auto part_hash_table = BuildHashTableForPart(lineitem_data, path_to_part);
+// Page is the page type of the part relation. lineitem may have been read with
+// a different page size than part.
+template <typename Page>
+void RunQuery(const InMemoryLineitemData &lineitem_data,
+              const char *path_to_part, size_t page_size_power,
+              size_t lineitem_page_size_power, unsigned num_threads,
+              unsigned num_entries_per_ring, unsigned num_tuples_per_coroutine,
+              bool batched_probe, bool print_result, bool print_header) {
+  auto part_hash_table =
+      BuildHashTableForPart<Page>(lineitem_data, path_to_part);
 
   File part_data_file{path_to_part, File::kRead, true};
 
   auto total_num_references = part_hash_table.GetTotalNumPageReferences();
   auto ten_percent = (total_num_references + 9) / 10;
 
+  // all runs share the threads, so they do not pay for starting them
+  WorkerPool workers{num_threads, num_entries_per_ring};
+
   if (print_header) {
     std::cout << "kind_of_io,page_size_power,num_threads,num_cached_references,"
                  "num_total_references,"
-                 "num_entries_per_ring,num_tuples_per_coroutine,time\n";
+                 "num_entries_per_ring,num_tuples_per_coroutine,time,num_local_"
+                 "hits,num_remote_hits,num_misses,num_page_reads,"
+                 "lineitem_page_size_power,probe\n";
   }
 
   for (int i = 0; i != 11; ++i) {
     {
-      QueryRunner synchronousRunner{part_hash_table, part_data_file,
-                                    lineitem_data, num_threads};
+      QueryRunner<Page> synchronousRunner{part_hash_table, part_data_file,
+                                          lineitem_data, workers,
+                                          batched_probe};
       auto start = std::chrono::steady_clock::now();
       synchronousRunner.StartProcessing();
       synchronousRunner.DoPostProcessing(print_result);
@@ -694,15 +1040,22 @@ int main(int argc, char *argv[]) {
       auto milliseconds =
           std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
               .count();
-      std::cout << "synchronous," << kPageSizePower << "," << num_threads << ","
-                << part_hash_table.GetNumAlreadyCachedReferences() << ","
-                << total_num_references << ",0,0," << milliseconds << "\n";
+      auto statistics = synchronousRunner.GetNumaStatistics();
+      auto num_page_reads = synchronousRunner.GetNumPageReads();
+      std::cout << "synchronous," << page_size_power << "," << num_threads
+                << "," << part_hash_table.GetNumAlreadyCachedReferences() << ","
+                << total_num_references << ",0,0," << milliseconds << ","
+                << statistics.num_local_hits << ","
+                << statistics.num_remote_hits << "," << statistics.num_misses
+                << "," << num_page_reads << "," << lineitem_page_size_power
+                << ","
+                << (batched_probe ? "batched" : "single") << "\n";
     }
 
     {
-      QueryRunner asynchronousRunner{part_hash_table, part_data_file,
-                                     lineitem_data, num_threads,
-                                     num_entries_per_ring};
+      QueryRunner<Page> asynchronousRunner{part_hash_table, part_data_file,
+                                           lineitem_data, workers,
+                                           batched_probe, num_entries_per_ring};
       auto start = std::chrono::steady_clock::now();
       asynchronousRunner.StartProcessing(num_tuples_per_coroutine);
       asynchronousRunner.DoPostProcessing(print_result);
@@ -710,13 +1063,77 @@ int main(int argc, char *argv[]) {
       auto milliseconds =
           std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
               .count();
-      std::cout << "asynchronous," << kPageSizePower << "," << num_threads
+      auto statistics = asynchronousRunner.GetNumaStatistics();
+      auto num_page_reads = asynchronousRunner.GetNumPageReads();
+      std::cout << "asynchronous," << page_size_power << "," << num_threads
                 << "," << part_hash_table.GetNumAlreadyCachedReferences() << ","
                 << total_num_references << "," << num_entries_per_ring << ","
-                << num_tuples_per_coroutine << "," << milliseconds << "\n";
+                << num_tuples_per_coroutine << "," << milliseconds << ","
+                << statistics.num_local_hits << ","
+                << statistics.num_remote_hits << "," << statistics.num_misses
+                << "," << num_page_reads << "," << lineitem_page_size_power
+                << ","
+                << (batched_probe ? "batched" : "single") << "\n";
     }
 
     part_hash_table.CacheAtLeastNumReferences(part_data_file,
                                               (i + 1) * ten_percent);
   }
-}
\ No newline at end of file
+}
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 8 || argc > 10) {
+    std::cerr << "Usage: " << argv[0]
+              << " lineitem.dat partQ14.dat num_threads num_entries_per_ring "
+                 "num_tuples_per_coroutine "
+                 "print_result print_header [full|late] [single|batched]\n";
+    return 1;
+  }
+
+  const char *path_to_lineitem = argv[1];
+  const char *path_to_part = argv[2];
+  unsigned num_threads = std::atoi(argv[3]);
+  unsigned num_entries_per_ring = std::atoi(argv[4]);
+  unsigned num_tuples_per_coroutine = std::atoi(argv[5]);
+  bool print_result;
+  std::istringstream(argv[6]) >> std::boolalpha >> print_result;
+  bool print_header;
+  std::istringstream(argv[7]) >> std::boolalpha >> print_header;
+
+  std::string_view lineitem_scan = "full";
+  if (argc == 9) {
+    lineitem_scan = argv[8];
+  }
+  if (lineitem_scan != "full" && lineitem_scan != "late") {
+    std::cerr << "Unknown lineitem scan " << lineitem_scan << "\n";
+    return 1;
+  }
+
+  std::string_view probe = "single";
+  if (argc == 10) {
+    probe = argv[9];
+  }
+  if (probe != "single" && probe != "batched") {
+    std::cerr << "Unknown probe " << probe << "\n";
+    return 1;
+  }
+
+  // every data file has its own page size, e.g., lineitem can be scanned with
+  // large pages while part is probed with small ones
+  auto lineitem_page_size_power =
+      Catalog::ReadFor(path_to_lineitem).GetHeader().page_size_power;
+  auto part_page_size_power =
+      Catalog::ReadFor(path_to_part).GetHeader().page_size_power;
+
+  InMemoryLineitemData lineitem_data = LoadLineitem(
+      path_to_lineitem, lineitem_page_size_power, lineitem_scan == "late");
+
+  DispatchPageSize(part_page_size_power, [&](auto page_size) {
+    RunQuery<BasicPartPageQ14<decltype(page_size)::value>>(
+        lineitem_data, path_to_part, part_page_size_power,
+        lineitem_page_size_power, num_threads, num_entries_per_ring,
+        num_tuples_per_coroutine, probe == "batched", print_result,
+        print_header);
+  });
+}
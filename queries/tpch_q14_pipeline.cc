@@ -0,0 +1,198 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ios>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "storage/catalog.h"
+#include "storage/file.h"
+#include "storage/pipeline.h"
+#include "storage/schema.h"
+#include "storage/swip.h"
+#include "storage/types.h"
+#include "storage/worker_pool.h"
+#include "storage/zone_map.h"
+
+namespace {
+using namespace storage;
+
+// Query 14 as a hash join of the pipeline library: part is scanned into a
+// hash table from p_partkey to whether p_type starts with PROMO, then the
+// qualifying tuples of lineitem probe it. Both scans read their pages from
+// disk.
+
+using PartTable = JoinHashTable<Integer, bool>;
+
+// The thread-local sums of a probe pipeline
+struct Revenue {
+  NumericSum<12, 4> promo;
+  NumericSum<12, 4> total;
+};
+
+std::vector<Swip> GetAllSwips(uint64_t num_pages) {
+  std::vector<Swip> swips;
+  swips.reserve(num_pages);
+  for (PageIndex i = 0; i != num_pages; ++i) {
+    swips.emplace_back(Swip::MakePageIndex(i));
+  }
+  return swips;
+}
+
+template <typename Page>
+void BuildPartTable(const char *path_to_part, PartTable &table,
+                    WorkerPool &workers, uint32_t num_ring_entries,
+                    uint64_t num_tuples_per_morsel) {
+  const File file{path_to_part, File::kRead, true};
+  auto swips = GetAllSwips(Catalog::ReadFor<Page>(path_to_part).GetNumPages());
+
+  auto make_pipeline = [&table](unsigned thread_index) {
+    return HashBuild{
+        table, thread_index,
+        [](const Page &page, uint32_t i) { return page.p_partkey()[i]; },
+        [](const Page &page, uint32_t i) {
+          std::string_view p_type(page.p_type()[i].Begin(),
+                                  page.p_type()[i].Size());
+          return p_type.starts_with("PROMO");
+        }};
+  };
+  std::vector<decltype(make_pipeline(0))> pipelines;
+  for (unsigned i = 0; i != workers.GetNumThreads(); ++i) {
+    pipelines.push_back(make_pipeline(i));
+  }
+  Scan<Page>(workers, file, swips, pipelines, num_ring_entries,
+             num_tuples_per_morsel);
+  table.Finish(workers);
+}
+
+template <typename Page>
+Revenue ProbePartTable(const char *path_to_lineitem, const PartTable &table,
+                       WorkerPool &workers, uint32_t num_ring_entries,
+                       uint64_t num_tuples_per_morsel) {
+  const File file{path_to_lineitem, File::kRead, true};
+  auto lower_date_boundary = Date::FromString("1995-09-01|", '|').value;
+  auto upper_date_boundary = Date::FromString("1995-09-30|", '|').value;
+
+  // pages without a single tuple in the shipdate range are not scanned
+  constexpr size_t kShipdateColumnIndex = Page::IndexOf("l_shipdate");
+  auto zone_map = ZoneMap::ReadFor(path_to_lineitem, Page::kNumColumns);
+  std::vector<Swip> swips;
+  for (auto swip : GetAllSwips(
+           Catalog::ReadFor<Page>(path_to_lineitem).GetNumPages())) {
+    if (zone_map.Match(swip.GetPageIndex(), kShipdateColumnIndex,
+                       lower_date_boundary,
+                       upper_date_boundary) != ZoneMatch::kNone) {
+      swips.push_back(swip);
+    }
+  }
+
+  std::vector<Revenue> revenues(workers.GetNumThreads());
+  auto make_pipeline = [&](Revenue &revenue) {
+    return Filter{
+        [=](const Page &page, uint32_t i) {
+          return lower_date_boundary <= page.l_shipdate()[i] &&
+                 page.l_shipdate()[i] <= upper_date_boundary;
+        },
+        HashProbe{
+            table,
+            [](const Page &page, uint32_t i) { return page.l_partkey()[i]; },
+            Aggregate{revenue, [](Revenue &revenue, const Page &page,
+                                  uint32_t i, bool is_promo) {
+                        auto sum = page.l_extendedprice()[i] *
+                                   (Numeric<12, 2>{100ll} -
+                                    page.l_discount()[i]);
+                        if (is_promo) {
+                          revenue.promo += sum;
+                        }
+                        revenue.total += sum;
+                      }}}};
+  };
+  std::vector<decltype(make_pipeline(revenues.front()))> pipelines;
+  for (auto &revenue : revenues) {
+    pipelines.push_back(make_pipeline(revenue));
+  }
+  Scan<Page>(workers, file, swips, pipelines, num_ring_entries,
+             num_tuples_per_morsel);
+
+  Revenue result;
+  for (const auto &revenue : revenues) {
+    result.promo += revenue.promo;
+    result.total += revenue.total;
+  }
+  return result;
+}
+
+void RunQuery(const char *path_to_lineitem, const char *path_to_part,
+              WorkerPool &workers, uint32_t num_ring_entries,
+              uint64_t num_tuples_per_morsel, bool print_result) {
+  PartTable table{workers.GetNumThreads()};
+  DispatchPageSize(
+      Catalog::ReadFor(path_to_part).GetHeader().page_size_power,
+      [&](auto page_size) {
+        BuildPartTable<BasicPartPageQ14<decltype(page_size)::value>>(
+            path_to_part, table, workers, num_ring_entries,
+            num_tuples_per_morsel);
+      });
+
+  Revenue revenue;
+  DispatchPageSize(
+      Catalog::ReadFor(path_to_lineitem).GetHeader().page_size_power,
+      [&](auto page_size) {
+        using Page = BasicLineitemPageQ14<decltype(page_size)::value>;
+        revenue = ProbePartTable<Page>(path_to_lineitem, table, workers,
+                                       num_ring_entries,
+                                       num_tuples_per_morsel);
+      });
+
+  // 100 * promo / total
+  auto result = Numeric<12, 4>{1'000'000ll} * (revenue.promo / revenue.total);
+  if (print_result) {
+    std::cerr << "promo_revenue\n" << result << "\n";
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 8) {
+    std::cerr << "Usage: " << argv[0]
+              << " lineitem.dat partQ14.dat num_threads num_entries_per_ring "
+                 "num_tuples_per_morsel print_result print_header\n";
+    return 1;
+  }
+
+  const char *path_to_lineitem = argv[1];
+  const char *path_to_part = argv[2];
+  unsigned num_threads = std::atoi(argv[3]);
+  unsigned num_entries_per_ring = std::atoi(argv[4]);
+  uint64_t num_tuples_per_morsel = std::atoll(argv[5]);
+  bool print_result;
+  std::istringstream(argv[6]) >> std::boolalpha >> print_result;
+  bool print_header;
+  std::istringstream(argv[7]) >> std::boolalpha >> print_header;
+
+  if (print_header) {
+    std::cout << "kind_of_io,num_threads,num_entries_per_ring,num_tuples_per_"
+                 "morsel,time\n";
+  }
+
+  // the synchronous and the asynchronous run share all of their code except
+  // for how the scans read pages. They also share the threads, so neither pays
+  // for starting them.
+  WorkerPool workers{num_threads, num_entries_per_ring};
+  for (uint32_t num_ring_entries : {0u, num_entries_per_ring}) {
+    auto start = std::chrono::steady_clock::now();
+    RunQuery(path_to_lineitem, path_to_part, workers, num_ring_entries,
+             num_tuples_per_morsel, print_result);
+    auto end = std::chrono::steady_clock::now();
+    auto milliseconds =
+        std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+            .count();
+    std::cout << (num_ring_entries == 0 ? "synchronous," : "asynchronous,")
+              << num_threads << "," << num_ring_entries << ","
+              << num_tuples_per_morsel << "," << milliseconds << "\n";
+  }
+}
@@ -0,0 +1,52 @@
+#include "storage/catalog.h"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace storage {
+
+Catalog Catalog::ReadFor(const char *path_to_data) {
+  auto path = GetPath(path_to_data);
+  if (access(path.c_str(), F_OK) != 0) {
+    throw std::runtime_error{std::string{path_to_data} +
+                             " has no catalog, load it again with load_data"};
+  }
+
+  // the whole catalog is read at once
+  const File file{path.c_str(), File::kRead};
+  std::vector<std::byte> buffer(file.ReadSize());
+  file.ReadBlock(buffer.data(), 0, buffer.size());
+
+  Summary summary;
+  if (buffer.size() < sizeof(summary)) {
+    throw std::runtime_error{"The catalog " + path + " is truncated"};
+  }
+  std::memcpy(&summary, buffer.data(), sizeof(summary));
+  if (summary.header.magic != DataFileHeader::kMagic ||
+      summary.header.version != DataFileHeader::kVersion ||
+      buffer.size() !=
+          sizeof(summary) + summary.num_pages * sizeof(uint32_t)) {
+    throw std::runtime_error{"The catalog " + path + " is invalid"};
+  }
+
+  Catalog catalog;
+  catalog.header_ = summary.header;
+  catalog.num_tuples_ = summary.num_tuples;
+  catalog.page_num_tuples_.resize(summary.num_pages);
+  std::memcpy(catalog.page_num_tuples_.data(), buffer.data() + sizeof(summary),
+              summary.num_pages * sizeof(uint32_t));
+  return catalog;
+}
+
+void Catalog::WriteFor(const char *path_to_data) const {
+  Summary summary{header_, GetNumPages(), num_tuples_};
+  File file{GetPath(path_to_data).c_str(), File::kWrite};
+  file.AppendBlock(reinterpret_cast<const std::byte *>(&summary),
+                   sizeof(summary));
+  file.AppendBlock(reinterpret_cast<const std::byte *>(page_num_tuples_.data()),
+                   page_num_tuples_.size() * sizeof(uint32_t));
+}
+
+}  // namespace storage
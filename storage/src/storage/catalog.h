@@ -0,0 +1,108 @@
+#ifndef STORAGE_CATALOG_H_
+#define STORAGE_CATALOG_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "storage/file.h"
+
+namespace storage {
+
+// Describes the contents of a data file: its header and the number of tuples
+// of every page. load_data stores the catalog next to the data file, so that
+// the queries learn the cardinality of a relation with a single small read
+// instead of scanning it.
+class Catalog {
+ public:
+  Catalog() = default;
+
+  static std::string GetPath(const char *path_to_data) {
+    return std::string{path_to_data} + ".catalog";
+  }
+
+  // Reads the catalog of the data file. Throws if there is none.
+  static Catalog ReadFor(const char *path_to_data);
+
+  // Like ReadFor(), but also throws if the data file does not consist of pages
+  // of type Page
+  template <typename Page>
+  static Catalog ReadFor(const char *path_to_data) {
+    auto catalog = ReadFor(path_to_data);
+    if (!catalog.header_.Describes<Page>()) {
+      throw std::runtime_error{std::string{path_to_data} +
+                               " does not contain pages of the expected type"};
+    }
+    return catalog;
+  }
+
+  void WriteFor(const char *path_to_data) const;
+
+  // Computes the catalog of a data file consisting of pages of type Page
+  template <typename Page>
+  static Catalog Compute(const char *path_to_data) {
+    Catalog catalog;
+    catalog.header_ = File{path_to_data, File::kRead}.ReadHeader();
+    if (!catalog.header_.Describes<Page>()) {
+      throw std::runtime_error{std::string{path_to_data} +
+                               " does not contain pages of the expected type"};
+    }
+    catalog.Update<Page>(path_to_data, 0);
+    return catalog;
+  }
+
+  // Recomputes the numbers of tuples of the pages from first_page_index on,
+  // e.g. after tuples were appended to the data file
+  template <typename Page>
+  void Update(const char *path_to_data, PageIndex first_page_index) {
+    first_page_index = std::min<PageIndex>(first_page_index, GetNumPages());
+    for (auto page_index = first_page_index; page_index != GetNumPages();
+         ++page_index) {
+      num_tuples_ -= page_num_tuples_[page_index];
+    }
+
+    // every page type starts with the number of tuples
+    const File file{path_to_data, File::kRead};
+    auto num_pages = file.GetNumPages(sizeof(Page));
+    page_num_tuples_.resize(num_pages);
+    for (auto page_index = first_page_index; page_index < num_pages;
+         ++page_index) {
+      auto &num_tuples = page_num_tuples_[page_index];
+      file.ReadBlock(reinterpret_cast<std::byte *>(&num_tuples),
+                     File::GetPageOffset(page_index, sizeof(Page)),
+                     sizeof(num_tuples));
+      num_tuples_ += num_tuples;
+    }
+  }
+
+  const DataFileHeader &GetHeader() const noexcept { return header_; }
+
+  uint64_t GetNumPages() const noexcept { return page_num_tuples_.size(); }
+
+  // The total number of tuples of the relation
+  uint64_t GetNumTuples() const noexcept { return num_tuples_; }
+
+  uint32_t GetNumTuples(PageIndex page_index) const noexcept {
+    return page_num_tuples_[page_index];
+  }
+
+ private:
+  // The catalog file starts with this, followed by the number of tuples of
+  // every page as uint32_t
+  struct Summary {
+    DataFileHeader header;
+    uint64_t num_pages;
+    uint64_t num_tuples;
+  };
+
+  DataFileHeader header_;
+  uint64_t num_tuples_{0};
+  std::vector<uint32_t> page_num_tuples_;
+};
+
+}  // namespace storage
+
+#endif  // STORAGE_CATALOG_H_
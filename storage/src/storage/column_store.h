@@ -0,0 +1,177 @@
+#ifndef STORAGE_COLUMN_STORE_H_
+#define STORAGE_COLUMN_STORE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "cppcoro/task.hpp"
+#include "storage/file.h"
+#include "storage/io_uring.h"
+#include "storage/pax_page.h"
+
+namespace storage {
+
+// The number of tuples in a row group: a row group of an 8-byte column fills
+// a page of the default size and the row group of every column is a multiple
+// of kIOAlignment bytes
+constexpr uint64_t kRowGroupNumTuples =
+    std::max<uint64_t>(kPageSize / sizeof(uint64_t), kIOAlignment);
+
+// The values of kRowGroupNumTuples consecutive tuples in memory. Like a
+// PaxPage, but every column starts at a multiple of kIOAlignment, so that each
+// column can be read from its own file directly into the group.
+template <typename... Columns>
+struct alignas(kIOAlignment) ColumnGroup {
+  static constexpr size_t kNumColumns = sizeof...(Columns);
+
+  template <size_t kIndex>
+  using ColumnType =
+      typename std::tuple_element_t<kIndex, std::tuple<Columns...>>::Type;
+
+  static constexpr std::array<std::string_view, kNumColumns> kColumnNames = {
+      Columns::GetName()...};
+
+  static constexpr std::array<size_t, kNumColumns> kValueSizes = {
+      sizeof(typename Columns::Type)...};
+
+  static constexpr uint64_t kMaxNumTuples = kRowGroupNumTuples;
+
+  // The offsets of the columns relative to the beginning of the group
+  static constexpr std::array<size_t, kNumColumns> kColumnOffsets =
+      detail::ComputePaxColumnOffsets(kValueSizes, kMaxNumTuples,
+                                      kIOAlignment);
+
+  static constexpr size_t kSize =
+      kColumnOffsets.back() + kMaxNumTuples * kValueSizes.back();
+
+  static constexpr size_t IndexOf(std::string_view name) noexcept {
+    return std::find(kColumnNames.begin(), kColumnNames.end(), name) -
+           kColumnNames.begin();
+  }
+
+  template <size_t kIndex>
+  std::span<ColumnType<kIndex>, kMaxNumTuples> Get() noexcept {
+    return std::span<ColumnType<kIndex>, kMaxNumTuples>{
+        reinterpret_cast<ColumnType<kIndex> *>(
+            reinterpret_cast<std::byte *>(this) + kColumnOffsets[kIndex]),
+        kMaxNumTuples};
+  }
+
+  template <size_t kIndex>
+  std::span<const ColumnType<kIndex>, kMaxNumTuples> Get() const noexcept {
+    return std::span<const ColumnType<kIndex>, kMaxNumTuples>{
+        reinterpret_cast<const ColumnType<kIndex> *>(
+            reinterpret_cast<const std::byte *>(this) + kColumnOffsets[kIndex]),
+        kMaxNumTuples};
+  }
+
+  uint32_t num_tuples;
+
+ private:
+  std::array<std::byte, kSize - sizeof(uint32_t)> data_;
+};
+
+// The column files of a table all start with the same prefix
+inline std::string GetColumnPath(std::string_view prefix,
+                                 std::string_view column_name) {
+  return std::string{prefix} + "." + std::string{column_name};
+}
+
+// Stores the number of tuples that a row group can hold followed by the
+// number of tuples of every row group
+inline std::string GetRowGroupIndexPath(std::string_view prefix) {
+  return std::string{prefix} + ".rowgroups";
+}
+
+// Reads the columns of Group from a table that is stored as one file per
+// column. The i-th row group of a column is stored at offset
+// i * kMaxNumTuples * sizeof(value) of its file. The interface mirrors File
+// with row groups in place of pages.
+template <typename Group>
+class ColumnStore {
+ public:
+  static_assert(Group::kMaxNumTuples == kRowGroupNumTuples);
+
+  ColumnStore(const char *prefix, bool use_direct_io_for_reading = false) {
+    for (auto column_name : Group::kColumnNames) {
+      files_.push_back(std::make_unique<File>(
+          GetColumnPath(prefix, column_name).c_str(), File::kRead,
+          use_direct_io_for_reading));
+    }
+
+    // the row groups are stored at offsets that depend on their capacity, so
+    // it must match the one the table was loaded with
+    auto index_path = GetRowGroupIndexPath(prefix);
+    const File index{index_path.c_str(), File::kRead};
+    std::vector<uint32_t> entries(index.ReadSize() / sizeof(uint32_t));
+    index.ReadBlock(reinterpret_cast<std::byte *>(entries.data()), 0,
+                    entries.size() * sizeof(uint32_t));
+    if (entries.empty() || entries.front() != Group::kMaxNumTuples) {
+      throw std::runtime_error{
+          index_path + " does not describe row groups of " +
+          std::to_string(Group::kMaxNumTuples) +
+          " tuples, load the table again with load_data"};
+    }
+    row_group_capacity_ = entries.front();
+    row_group_num_tuples_.assign(entries.begin() + 1, entries.end());
+  }
+
+  uint64_t GetNumRowGroups() const noexcept {
+    return row_group_num_tuples_.size();
+  }
+
+  // The number of tuples that a row group can hold as stored in the index
+  uint64_t GetRowGroupCapacity() const noexcept { return row_group_capacity_; }
+
+  // Returns the total size of the column files that are read
+  size_t ReadSize() const {
+    size_t size = 0;
+    for (const auto &file : files_) {
+      size += file->ReadSize();
+    }
+    return size;
+  }
+
+  void ReadPage(PageIndex row_group, Group *group) const {
+    auto *data = reinterpret_cast<std::byte *>(group);
+    for (size_t i = 0; i != Group::kNumColumns; ++i) {
+      auto size = GetColumnChunkSize(i);
+      files_[i]->ReadBlock(data + Group::kColumnOffsets[i], row_group * size,
+                           size);
+    }
+    group->num_tuples = row_group_num_tuples_[row_group];
+  }
+
+  cppcoro::task<void> AsyncReadPage(IOUring &ring, PageIndex row_group,
+                                    Group *group) const {
+    auto *data = reinterpret_cast<std::byte *>(group);
+    for (size_t i = 0; i != Group::kNumColumns; ++i) {
+      auto size = GetColumnChunkSize(i);
+      co_await files_[i]->AsyncReadBlock(
+          ring, data + Group::kColumnOffsets[i], row_group * size, size);
+    }
+    group->num_tuples = row_group_num_tuples_[row_group];
+  }
+
+ private:
+  static size_t GetColumnChunkSize(size_t column_index) noexcept {
+    return Group::kMaxNumTuples * Group::kValueSizes[column_index];
+  }
+
+  std::vector<std::unique_ptr<File>> files_;
+  uint64_t row_group_capacity_;
+  std::vector<uint32_t> row_group_num_tuples_;
+};
+
+}  // namespace storage
+
+#endif  // STORAGE_COLUMN_STORE_H_
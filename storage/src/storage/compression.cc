@@ -0,0 +1,58 @@
+#include "storage/compression.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace storage {
+namespace detail {
+
+namespace {
+
+// Eight values of kBitWidth bits take up exactly kBitWidth bytes, so within a
+// group of eight values the byte offsets and shifts are constants. The groups
+// are unpacked by a fixed sequence of loads, shifts and masks without
+// branches, which the compiler unrolls and vectorizes.
+template <unsigned kBitWidth>
+void UnpackGroups(const std::byte *data, uint64_t begin, uint32_t count,
+                  uint64_t *out) noexcept {
+  constexpr uint64_t kMask = (uint64_t{1} << kBitWidth) - 1;
+  uint32_t i = 0;
+  // the values before the first group
+  for (; i != count && (begin + i) % 8 != 0; ++i) {
+    out[i] = Unpack(data, begin + i, kBitWidth);
+  }
+  for (; count - i >= 8; i += 8) {
+    const std::byte *group = data + (begin + i) / 8 * kBitWidth;
+    for (unsigned j = 0; j != 8; ++j) {
+      uint64_t word;
+      std::memcpy(&word, group + j * kBitWidth / 8, sizeof(word));
+      out[i + j] = (word >> (j * kBitWidth % 8)) & kMask;
+    }
+  }
+  // the values after the last group
+  for (; i != count; ++i) {
+    out[i] = Unpack(data, begin + i, kBitWidth);
+  }
+}
+
+using UnpackFunction = void (*)(const std::byte *, uint64_t, uint32_t,
+                                uint64_t *) noexcept;
+
+// UnpackGroups for every bit width
+constexpr auto kUnpackFunctions =
+    []<unsigned... kBitWidths>(std::integer_sequence<unsigned, kBitWidths...>) {
+      return std::array<UnpackFunction, sizeof...(kBitWidths)>{
+          &UnpackGroups<kBitWidths>...};
+    }(std::make_integer_sequence<unsigned, kMaxBitWidth + 1>{});
+
+}  // namespace
+
+void UnpackBlock(const std::byte *data, uint64_t begin, uint32_t count,
+                 unsigned bit_width, uint64_t *out) noexcept {
+  kUnpackFunctions[bit_width](data, begin, count, out);
+}
+
+}  // namespace detail
+}  // namespace storage
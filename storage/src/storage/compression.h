@@ -0,0 +1,440 @@
+#ifndef STORAGE_COMPRESSION_H_
+#define STORAGE_COMPRESSION_H_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "storage/pax_page.h"
+
+namespace storage {
+
+enum class Encoding : uint8_t {
+  // the values are stored as they are
+  kPlain,
+  // the differences to the smallest value are bit-packed
+  kFrameOfReference,
+  // the distinct values are stored once, the bit-packed codes refer to them
+  kDictionary,
+  // one bit-packed value and the end position per run of equal values
+  kRunLength
+};
+
+namespace detail {
+
+// Bit-packed values are read with unaligned 8-byte loads, so they must not
+// need more bits than remain in a 64-bit word after shifting by up to 7 bits
+constexpr unsigned kMaxBitWidth = 56;
+
+constexpr size_t kMaxDictionarySize = 256;
+
+// Returns the signed integer that has the same bytes as the value. All column
+// types are wrappers around a single integer, so this preserves their order.
+template <typename T>
+int64_t ToRaw(const T &value) noexcept {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if constexpr (sizeof(T) == 1) {
+    int8_t raw;
+    std::memcpy(&raw, &value, sizeof(T));
+    return raw;
+  } else if constexpr (sizeof(T) == 2) {
+    int16_t raw;
+    std::memcpy(&raw, &value, sizeof(T));
+    return raw;
+  } else if constexpr (sizeof(T) == 4) {
+    int32_t raw;
+    std::memcpy(&raw, &value, sizeof(T));
+    return raw;
+  } else {
+    static_assert(sizeof(T) == 8, "Only integer-like types can be compressed");
+    int64_t raw;
+    std::memcpy(&raw, &value, sizeof(T));
+    return raw;
+  }
+}
+
+template <typename T>
+T FromRaw(int64_t raw) noexcept {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T value;
+  // little endian: the low bytes
+  std::memcpy(static_cast<void *>(&value), &raw, sizeof(T));
+  return value;
+}
+
+// The size of num_values bit-packed values including the padding that allows
+// reading the last value with an 8-byte load
+constexpr size_t GetPackedSize(uint64_t num_values, unsigned bit_width) {
+  return RoundUp(num_values * bit_width, 64) / 8 + 8;
+}
+
+inline void Pack(std::byte *data, uint64_t index, unsigned bit_width,
+                 uint64_t value) noexcept {
+  uint64_t bit = index * bit_width;
+  uint64_t word;
+  std::memcpy(&word, data + bit / 8, sizeof(word));
+  word |= value << (bit % 8);
+  std::memcpy(data + bit / 8, &word, sizeof(word));
+}
+
+inline uint64_t Unpack(const std::byte *data, uint64_t index,
+                       unsigned bit_width) noexcept {
+  uint64_t mask = (uint64_t{1} << bit_width) - 1;
+  uint64_t bit = index * bit_width;
+  uint64_t word;
+  std::memcpy(&word, data + bit / 8, sizeof(word));
+  return (word >> (bit % 8)) & mask;
+}
+
+// The number of values that the decoders unpack at once
+constexpr uint32_t kUnpackBlockSize = 256;
+
+// Writes the bit-packed values [begin, begin + count) to out. Unlike Unpack(),
+// this does not extract one value at a time with a runtime bit width but
+// dispatches once to a loop that is specialized for the bit width.
+void UnpackBlock(const std::byte *data, uint64_t begin, uint32_t count,
+                 unsigned bit_width, uint64_t *out) noexcept;
+
+// The properties of a sequence of values that determine how well each
+// encoding compresses it
+class ColumnStatistics {
+ public:
+  void Add(int64_t value) {
+    if (num_values_ == 0) {
+      min_ = max_ = value;
+      num_runs_ = 1;
+    } else {
+      min_ = std::min(min_, value);
+      max_ = std::max(max_, value);
+      num_runs_ += value != last_;
+    }
+    last_ = value;
+    ++num_values_;
+
+    if (distinct_values_.size() <= kMaxDictionarySize) {
+      auto iter = std::lower_bound(distinct_values_.begin(),
+                                   distinct_values_.end(), value);
+      if (iter == distinct_values_.end() || *iter != value) {
+        distinct_values_.insert(iter, value);
+      }
+    }
+  }
+
+  int64_t GetMin() const noexcept { return min_; }
+
+  unsigned GetRangeBitWidth() const noexcept {
+    return std::bit_width(static_cast<uint64_t>(max_) -
+                          static_cast<uint64_t>(min_));
+  }
+
+  unsigned GetCodeBitWidth() const noexcept {
+    return std::bit_width(distinct_values_.size() - 1);
+  }
+
+  const std::vector<int64_t> &GetDistinctValues() const noexcept {
+    return distinct_values_;
+  }
+
+  // Returns the encoding that needs the fewest bytes and that size
+  std::pair<Encoding, size_t> ChooseEncoding(size_t value_size) const {
+    std::pair<Encoding, size_t> best{Encoding::kPlain,
+                                     RoundUp(num_values_ * value_size, 8)};
+    auto consider = [&best](Encoding encoding, size_t size) {
+      if (size < best.second) {
+        best = {encoding, size};
+      }
+    };
+
+    if (GetRangeBitWidth() <= kMaxBitWidth) {
+      consider(Encoding::kFrameOfReference,
+               GetPackedSize(num_values_, GetRangeBitWidth()));
+      consider(Encoding::kRunLength,
+               RoundUp(num_runs_ * sizeof(uint32_t), 8) +
+                   GetPackedSize(num_runs_, GetRangeBitWidth()));
+    }
+    if (distinct_values_.size() <= kMaxDictionarySize) {
+      consider(Encoding::kDictionary,
+               distinct_values_.size() * sizeof(int64_t) +
+                   GetPackedSize(num_values_, GetCodeBitWidth()));
+    }
+    return best;
+  }
+
+ private:
+  std::vector<int64_t> distinct_values_;
+  uint64_t num_values_{0};
+  uint64_t num_runs_{0};
+  int64_t min_{0};
+  int64_t max_{0};
+  int64_t last_{0};
+};
+
+}  // namespace detail
+
+// A page of the same size and with the same columns as the PaxPage Page, but
+// every column is compressed with the encoding that suits its values on this
+// page best. The values are decoded in blocks with Decode().
+template <typename Page>
+struct alignas(sizeof(Page)) CompressedPage {
+  static constexpr size_t kSize = sizeof(Page);
+  static constexpr size_t kNumColumns = Page::kNumColumns;
+  static constexpr const auto &kColumnNames = Page::kColumnNames;
+  static constexpr const auto &kTable = Page::kTable;
+  static constexpr uint64_t kLayoutId = detail::ComputeLayoutId(
+      "compressed", Page::kColumnNames, Page::kValueSizes);
+
+  template <size_t kIndex>
+  using ColumnType = typename Page::template ColumnType<kIndex>;
+
+  static constexpr size_t kMaxCompressionRatio = 8;
+
+  // Parsed tuples are collected in a larger uncompressed page from which as
+  // many tuples as fit are compressed into the next page
+  struct Staging : Page::template Resized<kSize * kMaxCompressionRatio> {
+    static constexpr const auto &kTable = Page::kTable;
+
+    // Removes the first count of the num_tuples staged tuples
+    void RemoveFirst(uint32_t count, uint32_t num_tuples) noexcept {
+      ForEachColumn([&](auto index) {
+        auto column = this->template Get<index>();
+        std::memmove(column.data(), column.data() + count,
+                     (num_tuples - count) * sizeof(column.front()));
+      });
+    }
+  };
+
+  static constexpr uint64_t kMaxNumTuples = Staging::kMaxNumTuples;
+
+  // Compresses as many of the count tuples starting at begin as fit into the
+  // page and returns their number
+  uint32_t Compress(const Staging &staging, uint32_t begin, uint32_t count) {
+    // determine how many tuples fit
+    std::array<detail::ColumnStatistics, kNumColumns> statistics;
+    uint32_t fitting = 0;
+    for (; fitting != count; ++fitting) {
+      ForEachColumn([&](auto index) {
+        statistics[index].Add(
+            detail::ToRaw(staging.template Get<index>()[begin + fitting]));
+      });
+      if (GetCompressedSize(statistics) > kSize) {
+        break;
+      }
+    }
+
+    // compress them
+    std::memset(this, 0, kSize);
+    num_tuples = fitting;
+    size_t offset = kDataOffset;
+    ForEachColumn([&](auto index) {
+      detail::ColumnStatistics column_statistics;
+      auto values = staging.template Get<index>().subspan(begin, fitting);
+      for (const auto &value : values) {
+        column_statistics.Add(detail::ToRaw(value));
+      }
+      offset = detail::RoundUp(offset, kCacheLineSize);
+      offset += CompressColumn(columns_[index], offset, values,
+                               column_statistics);
+    });
+    return fitting;
+  }
+
+  // Writes the values of the tuples [begin, begin + count) of the kIndex-th
+  // column to out
+  template <size_t kIndex>
+  void Decode(uint32_t begin, uint32_t count,
+              ColumnType<kIndex> *out) const noexcept {
+    using T = ColumnType<kIndex>;
+    const ColumnHeader &header = columns_[kIndex];
+    const std::byte *data =
+        reinterpret_cast<const std::byte *>(this) + header.offset;
+    switch (header.encoding) {
+      case Encoding::kPlain: {
+        std::memcpy(out, data + begin * sizeof(T), count * sizeof(T));
+        break;
+      }
+      case Encoding::kFrameOfReference: {
+        // unpacking and widening are separate loops, so that the widening
+        // is vectorized for every column type
+        uint64_t values[detail::kUnpackBlockSize];
+        for (uint32_t i = 0; i < count; i += detail::kUnpackBlockSize) {
+          auto n = std::min(count - i, detail::kUnpackBlockSize);
+          detail::UnpackBlock(data, begin + i, n, header.bit_width, values);
+          for (uint32_t j = 0; j != n; ++j) {
+            out[i + j] = detail::FromRaw<T>(header.base + values[j]);
+          }
+        }
+        break;
+      }
+      case Encoding::kDictionary: {
+        const std::byte *codes = data + header.num_entries * sizeof(int64_t);
+        uint64_t values[detail::kUnpackBlockSize];
+        for (uint32_t i = 0; i < count; i += detail::kUnpackBlockSize) {
+          auto n = std::min(count - i, detail::kUnpackBlockSize);
+          detail::UnpackBlock(codes, begin + i, n, header.bit_width, values);
+          for (uint32_t j = 0; j != n; ++j) {
+            int64_t value;
+            std::memcpy(&value, data + values[j] * sizeof(int64_t),
+                        sizeof(value));
+            out[i + j] = detail::FromRaw<T>(value);
+          }
+        }
+        break;
+      }
+      case Encoding::kRunLength: {
+        auto *run_ends = reinterpret_cast<const uint32_t *>(data);
+        const std::byte *values =
+            data + detail::RoundUp(header.num_entries * sizeof(uint32_t), 8);
+        auto run = std::upper_bound(run_ends, run_ends + header.num_entries,
+                                    begin) -
+                   run_ends;
+        for (uint32_t position = begin, end = begin + count; position < end;
+             ++run) {
+          auto run_end = std::min(run_ends[run], end);
+          std::fill(out + (position - begin), out + (run_end - begin),
+                    detail::FromRaw<T>(header.base +
+                                       detail::Unpack(values, run,
+                                                      header.bit_width)));
+          position = run_end;
+        }
+        break;
+      }
+    }
+  }
+
+  // Decodes the tuples starting at begin into the uncompressed page block and
+  // returns their number
+  template <typename Block>
+  uint32_t DecodeBlock(uint32_t begin, Block &block) const noexcept {
+    uint32_t count =
+        std::min<uint64_t>(Block::kMaxNumTuples, num_tuples - begin);
+    ForEachColumn([&](auto index) {
+      Decode<index>(begin, count, block.template Get<index>().data());
+    });
+    block.num_tuples = count;
+    return count;
+  }
+
+  Encoding GetEncoding(size_t column_index) const noexcept {
+    return columns_[column_index].encoding;
+  }
+
+  uint32_t num_tuples;
+
+ private:
+  struct ColumnHeader {
+    int64_t base;
+    uint32_t offset;       // relative to the beginning of the page
+    uint32_t num_entries;  // dictionary entries or runs
+    Encoding encoding;
+    uint8_t bit_width;
+  };
+
+  static constexpr size_t kHeaderSize =
+      detail::RoundUp(sizeof(uint32_t), alignof(ColumnHeader)) +
+      kNumColumns * sizeof(ColumnHeader);
+  static constexpr size_t kDataOffset = kHeaderSize;
+
+  template <typename F>
+  static void ForEachColumn(F &&f) {
+    [&f]<size_t... kIndexes>(std::index_sequence<kIndexes...>) {
+      (f(std::integral_constant<size_t, kIndexes>{}), ...);
+    }(std::make_index_sequence<kNumColumns>{});
+  }
+
+  static size_t GetCompressedSize(
+      const std::array<detail::ColumnStatistics, kNumColumns> &statistics) {
+    size_t size = kDataOffset;
+    ForEachColumn([&](auto index) {
+      size = detail::RoundUp(size, kCacheLineSize) +
+             statistics[index]
+                 .ChooseEncoding(sizeof(ColumnType<index>))
+                 .second;
+    });
+    return size;
+  }
+
+  // Writes the values to the given offset and returns the number of bytes used
+  template <typename T>
+  size_t CompressColumn(ColumnHeader &header, size_t offset,
+                        std::span<const T> values,
+                        const detail::ColumnStatistics &statistics) {
+    auto [encoding, size] = statistics.ChooseEncoding(sizeof(T));
+    std::byte *data = reinterpret_cast<std::byte *>(this) + offset;
+    header = {statistics.GetMin(), static_cast<uint32_t>(offset), 0, encoding,
+              0};
+
+    switch (encoding) {
+      case Encoding::kPlain: {
+        std::memcpy(data, values.data(), values.size() * sizeof(T));
+        break;
+      }
+      case Encoding::kFrameOfReference: {
+        header.bit_width = statistics.GetRangeBitWidth();
+        for (uint64_t i = 0; i != values.size(); ++i) {
+          detail::Pack(data, i, header.bit_width,
+                       detail::ToRaw(values[i]) - header.base);
+        }
+        break;
+      }
+      case Encoding::kDictionary: {
+        const auto &dictionary = statistics.GetDistinctValues();
+        header.num_entries = dictionary.size();
+        header.bit_width = statistics.GetCodeBitWidth();
+        std::memcpy(data, dictionary.data(),
+                    dictionary.size() * sizeof(int64_t));
+        std::byte *codes = data + dictionary.size() * sizeof(int64_t);
+        for (uint64_t i = 0; i != values.size(); ++i) {
+          auto code = std::lower_bound(dictionary.begin(), dictionary.end(),
+                                       detail::ToRaw(values[i])) -
+                      dictionary.begin();
+          detail::Pack(codes, i, header.bit_width, code);
+        }
+        break;
+      }
+      case Encoding::kRunLength: {
+        header.bit_width = statistics.GetRangeBitWidth();
+        std::vector<uint32_t> run_ends;
+        std::vector<int64_t> run_values;
+        for (uint32_t i = 0; i != values.size(); ++i) {
+          auto value = detail::ToRaw(values[i]);
+          if (run_values.empty() || run_values.back() != value) {
+            run_values.push_back(value);
+            run_ends.push_back(i + 1);
+          } else {
+            run_ends.back() = i + 1;
+          }
+        }
+        header.num_entries = run_ends.size();
+        std::memcpy(data, run_ends.data(), run_ends.size() * sizeof(uint32_t));
+        std::byte *packed_values =
+            data + detail::RoundUp(run_ends.size() * sizeof(uint32_t), 8);
+        for (uint64_t i = 0; i != run_values.size(); ++i) {
+          detail::Pack(packed_values, i, header.bit_width,
+                       run_values[i] - header.base);
+        }
+        break;
+      }
+    }
+    return size;
+  }
+
+  std::array<ColumnHeader, kNumColumns> columns_;
+  std::array<std::byte, kSize - kHeaderSize> data_;
+};
+
+template <typename Page>
+struct IsCompressedPage : std::false_type {};
+
+template <typename Page>
+struct IsCompressedPage<CompressedPage<Page>> : std::true_type {};
+
+}  // namespace storage
+
+#endif  // STORAGE_COMPRESSION_H_
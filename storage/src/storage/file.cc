@@ -5,9 +5,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <array>
 #include <cerrno>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 #include <system_error>
+#include <vector>
 
 namespace {
 [[noreturn]] static void ThrowErrno() {
@@ -25,7 +29,12 @@ File::File(const char *filename, Mode mode, bool use_direct_io_for_reading) {
       break;
     }
     case kWrite: {
-      fd_ = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+      // no O_APPEND, it would make pwrite() ignore the offset
+      fd_ = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+      break;
+    }
+    case kUpdate: {
+      fd_ = open(filename, O_RDWR);
       break;
     }
   }
@@ -85,6 +94,66 @@ cppcoro::task<void> File::AsyncReadBlock(IOUring &ring, std::byte *data,
   }
 }
 
+DataFileHeader File::ReadHeader() const {
+  DataFileHeader header;
+  if (ReadSize() < kDataFileHeaderSize) {
+    throw std::runtime_error{"The data file has no header"};
+  }
+  // O_DIRECT needs an aligned buffer of a multiple of the block size
+  alignas(kIOAlignment) std::array<std::byte, kDataFileHeaderSize> buffer;
+  ReadBlock(buffer.data(), 0, buffer.size());
+  std::memcpy(&header, buffer.data(), sizeof(header));
+  if (header.magic != DataFileHeader::kMagic) {
+    throw std::runtime_error{"The file is not a data file"};
+  }
+  if (header.version != DataFileHeader::kVersion) {
+    throw std::runtime_error{"Unsupported data file version " +
+                             std::to_string(header.version)};
+  }
+  return header;
+}
+
+void File::ReadPageBlocks(size_t page_offset,
+                          std::span<const PageBlock> blocks,
+                          std::byte *data) const {
+  for (const auto &block : blocks) {
+    ReadBlock(data + block.offset, page_offset + block.offset, block.size);
+  }
+}
+
+cppcoro::task<void> File::AsyncReadPageBlocks(IOUring &ring,
+                                              size_t page_offset,
+                                              std::span<const PageBlock> blocks,
+                                              std::byte *data) const {
+  std::vector<ReadRequest> requests;
+  requests.reserve(blocks.size());
+  size_t total_size = 0;
+  for (const auto &block : blocks) {
+    requests.push_back({data + block.offset, block.size,
+                        static_cast<off_t>(page_offset + block.offset)});
+    total_size += block.size;
+  }
+
+  __s32 bytes_read = co_await IOUringAwaiter(ring, requests, fd_);
+  if (bytes_read < 0) {
+    throw std::system_error{-bytes_read, std::system_category()};
+  }
+  if (static_cast<size_t>(bytes_read) != total_size) {
+    // some read was short, which is rare enough to simply read all blocks
+    // again one after the other
+    for (const auto &block : blocks) {
+      co_await AsyncReadBlock(ring, data + block.offset,
+                              page_offset + block.offset, block.size);
+    }
+  }
+}
+
+void File::AppendHeader(const DataFileHeader &header) {
+  std::array<std::byte, kDataFileHeaderSize> buffer{};
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  AppendBlock(buffer.data(), buffer.size());
+}
+
 void File::AppendBlock(const std::byte *data, size_t size) {
   ssize_t bytes_written = write(fd_, data, size);
   if (bytes_written == -1) {
@@ -96,4 +165,27 @@ void File::AppendBlock(const std::byte *data, size_t size) {
   }
 }
 
+void File::Allocate(size_t size) {
+  // posix_fallocate() rejects an empty range
+  if (size == 0) {
+    return;
+  }
+  if (int error = posix_fallocate(fd_, 0, size); error != 0) {
+    throw std::system_error{error, std::system_category()};
+  }
+}
+
+void File::WriteBlock(const std::byte *data, size_t offset, size_t size) {
+  size_t total_bytes_written = 0ull;
+  while (total_bytes_written < size) {
+    ssize_t bytes_written =
+        pwrite(fd_, data + total_bytes_written, size - total_bytes_written,
+               offset + total_bytes_written);
+    if (bytes_written < 0) {
+      ThrowErrno();
+    }
+    total_bytes_written += bytes_written;
+  }
+}
+
 }  // namespace storage
\ No newline at end of file
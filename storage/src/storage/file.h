@@ -1,22 +1,89 @@
 #ifndef STORAGE_FILE_H_
 #define STORAGE_FILE_H_
 
+#include <array>
+#include <bit>
 #include <cstdint>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 #include "cppcoro/task.hpp"
 #include "storage/io_uring.h"
+#include "storage/pax_page.h"
 
 namespace storage {
 
+// The supported page sizes are 2^12 to 2^22 bytes
+constexpr size_t kMinPageSizePower = 12;
+constexpr size_t kMaxPageSizePower = 22;
+
+// The page size of the data files that load_data writes unless it is told
+// otherwise
 constexpr size_t kPageSizePower = ASYNCHRONOUS_IO_PAGE_SIZE_POWER;
 constexpr size_t kPageSize = 1ull << kPageSizePower;
 
+static_assert(kPageSizePower >= kMinPageSizePower &&
+              kPageSizePower <= kMaxPageSizePower);
+
+// O_DIRECT requires buffers, offsets and sizes to be multiples of this
+constexpr size_t kIOAlignment = 4096;
+
 using PageIndex = size_t;
 
+// Every data file starts with this header. The header occupies
+// kDataFileHeaderSize bytes, so the pages that follow it are still aligned for
+// direct I/O.
+struct DataFileHeader {
+  static constexpr uint64_t kMagic = 0x544144434e595341;  // "ASYNCDAT"
+  static constexpr uint32_t kVersion = 2;
+
+  uint64_t magic{kMagic};
+  uint32_t version{kVersion};
+  uint32_t page_size_power{kPageSizePower};
+  // The kLayoutId of the page type
+  uint64_t page_layout_id{0};
+
+  template <typename Page>
+  static DataFileHeader For() noexcept {
+    DataFileHeader header;
+    header.page_size_power = std::countr_zero(sizeof(Page));
+    header.page_layout_id = Page::kLayoutId;
+    return header;
+  }
+
+  // Returns whether the file consists of pages of type Page
+  template <typename Page>
+  bool Describes() const noexcept {
+    return GetPageSize() == sizeof(Page) && page_layout_id == Page::kLayoutId;
+  }
+
+  size_t GetPageSize() const noexcept { return 1ull << page_size_power; }
+};
+
+constexpr size_t kDataFileHeaderSize = kIOAlignment;
+
+// Calls f with std::integral_constant<size_t, 2^page_size_power>, so that the
+// page types can be instantiated for a page size that is only known at runtime
+template <size_t kPower = kMinPageSizePower, typename F>
+void DispatchPageSize(size_t page_size_power, F &&f) {
+  if constexpr (kPower > kMaxPageSizePower) {
+    throw std::invalid_argument{"Unsupported page size 2^" +
+                                std::to_string(page_size_power)};
+  } else if (page_size_power == kPower) {
+    f(std::integral_constant<size_t, 1ull << kPower>{});
+  } else {
+    DispatchPageSize<kPower + 1>(page_size_power, std::forward<F>(f));
+  }
+}
+
 class File {
  public:
-  enum Mode { kRead, kWrite };
+  // kWrite truncates the file, kUpdate opens an existing file for reading and
+  // writing without truncating it
+  enum Mode { kRead, kWrite, kUpdate };
 
   // Opens the file
   File(const char *filename, Mode mode, bool use_direct_io_for_reading = false);
@@ -25,29 +92,99 @@ class File {
 
   size_t ReadSize() const;
 
-  void ReadPage(PageIndex page_index, std::byte *data) const {
-    auto offset = page_index * kPageSize;
-    ReadBlock(data, offset, kPageSize);
+  // Throws if the file does not start with a valid header
+  DataFileHeader ReadHeader() const;
+
+  // The pages of a data file follow its header
+  static size_t GetPageOffset(PageIndex page_index, size_t page_size) noexcept {
+    return kDataFileHeaderSize + page_index * page_size;
+  }
+
+  uint64_t GetNumPages(size_t page_size) const {
+    auto size = ReadSize();
+    if (size < kDataFileHeaderSize) {
+      return 0;
+    }
+    return (size - kDataFileHeaderSize) / page_size;
+  }
+
+  template <typename Page>
+  void ReadPage(PageIndex page_index, Page *page) const {
+    static_assert(sizeof(Page) >= 1ull << kMinPageSizePower);
+    ReadBlock(reinterpret_cast<std::byte *>(page),
+              GetPageOffset(page_index, sizeof(Page)), sizeof(Page));
   }
 
   void ReadBlock(std::byte *data, size_t offset, size_t size) const;
 
+  template <typename Page>
   cppcoro::task<void> AsyncReadPage(IOUring &ring, PageIndex page_index,
-                                    std::byte *data) const {
-    auto offset = page_index * kPageSize;
-    co_return co_await AsyncReadBlock(ring, data, offset, kPageSize);
+                                    Page *page) const {
+    static_assert(sizeof(Page) >= 1ull << kMinPageSizePower);
+    co_return co_await AsyncReadBlock(ring, reinterpret_cast<std::byte *>(page),
+                                      GetPageOffset(page_index, sizeof(Page)),
+                                      sizeof(Page));
   }
 
   cppcoro::task<void> AsyncReadBlock(IOUring &ring, std::byte *data,
                                      size_t offset, size_t size) const;
 
-  void AppendPages(const std::byte *data, size_t num_pages) {
-    AppendBlock(data, kPageSize * num_pages);
+  // Reads only the number of tuples and the columns with the given indexes of
+  // a PAX page into the same positions of data. The other bytes of data are
+  // left untouched. Useful for wide pages of which a query needs few columns.
+  template <typename Page, size_t... kColumnIndexes>
+  void ReadColumns(PageIndex page_index, std::byte *data) const {
+    ReadPageBlocks(GetPageOffset(page_index, sizeof(Page)),
+                   GetBlocks<Page, kColumnIndexes...>(), data);
+  }
+
+  template <typename Page, size_t... kColumnIndexes>
+  cppcoro::task<void> AsyncReadColumns(IOUring &ring, PageIndex page_index,
+                                       std::byte *data) const {
+    co_return co_await AsyncReadPageBlocks(
+        ring, GetPageOffset(page_index, sizeof(Page)),
+        GetBlocks<Page, kColumnIndexes...>(), data);
   }
 
+  void ReadPageBlocks(size_t page_offset, std::span<const PageBlock> blocks,
+                      std::byte *data) const;
+
+  // Submits the reads of all blocks at once, so the ring needs one free entry
+  // per block
+  cppcoro::task<void> AsyncReadPageBlocks(IOUring &ring, size_t page_offset,
+                                          std::span<const PageBlock> blocks,
+                                          std::byte *data) const;
+
+  // Must be the first write to a data file
+  void AppendHeader(const DataFileHeader &header);
+
+  // Appends at the current position of the file, which is not moved by
+  // WriteBlock()
   void AppendBlock(const std::byte *data, size_t size);
 
+  // Extends the file to the given size and allocates its blocks up front, so
+  // that several threads can then write to disjoint ranges of it
+  void Allocate(size_t size);
+
+  template <typename Page>
+  void WritePages(PageIndex first_page_index, const Page *pages,
+                  size_t num_pages) {
+    WriteBlock(reinterpret_cast<const std::byte *>(pages),
+               GetPageOffset(first_page_index, sizeof(Page)),
+               sizeof(Page) * num_pages);
+  }
+
+  void WriteBlock(const std::byte *data, size_t offset, size_t size);
+
  private:
+  template <typename Page, size_t... kColumnIndexes>
+  static std::span<const PageBlock> GetBlocks() noexcept {
+    static constexpr auto kBlocks = GetColumnBlocks<Page>(
+        std::array<size_t, sizeof...(kColumnIndexes)>{kColumnIndexes...},
+        kIOAlignment);
+    return kBlocks.Get();
+  }
+
   int fd_;
 };
 
@@ -1,13 +1,16 @@
 #ifndef STORAGE_FIND_PATTERN_H_
 #define STORAGE_FIND_PATTERN_H_
 
+#ifdef __AVX2__
 #include <immintrin.h>
+#endif
 
 namespace storage {
 // Returns the position of the pattern character within [iter, end), or end if
 // not found
 template <char kPattern>
 const char *FindPatternFast(const char *iter, const char *end) {
+#ifdef __AVX2__
   // Loop over the content in blocks of 32 characters
   auto end32 = end - 32;
   const auto expanded_pattern = _mm256_set1_epi8(kPattern);
@@ -20,6 +23,7 @@ const char *FindPatternFast(const char *iter, const char *end) {
       return iter + __builtin_ctzll(matches);
     }
   }
+#endif
 
   // Check the last few characters explicitly
   while ((iter < end) && ((*iter) != kPattern)) {
@@ -44,6 +48,7 @@ const char *FindPatternSlow(const char *iter, const char *end) {
 // [iter, end), or end if not found
 template <char kPattern>
 const char *FindNthPatternFast(const char *iter, const char *end, unsigned n) {
+#ifdef __AVX2__
   // Loop over the content in blocks of 32 characters
   auto end32 = end - 32;
   const auto expanded_pattern = _mm256_set1_epi8(kPattern);
@@ -63,6 +68,7 @@ const char *FindNthPatternFast(const char *iter, const char *end, unsigned n) {
       n -= num_hits;
     }
   }
+#endif
 
   // Check the last few characters explicitly
   for (; iter < end; ++iter) {
@@ -2,8 +2,14 @@
 #define STORAGE_IO_URING_H_
 
 #include <array>
+#include <cerrno>
 #include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
 #include <system_error>
+#include <vector>
 
 #include "cppcoro/coroutine.hpp"
 #include "cppcoro/task.hpp"
@@ -13,34 +19,54 @@ namespace storage {
 
 class IOUring;
 
+// A read of num_bytes bytes at offset of a file into buffer
+struct ReadRequest {
+  void *buffer;
+  size_t num_bytes;
+  off_t offset;
+};
+
 class IOUringAwaiter {
  public:
   IOUringAwaiter(IOUring &ring, void *buffer, size_t num_bytes, off_t offset,
                  int fd) noexcept
-      : ring_(ring),
-        buffer_(buffer),
-        num_bytes_(num_bytes),
-        offset_(offset),
-        fd_(fd) {}
+      : ring_(ring), request_{buffer, num_bytes, offset}, fd_(fd) {}
+
+  // Submits all requests at once and resumes when the last one has completed.
+  // The result is the total number of bytes read or the first error.
+  IOUringAwaiter(IOUring &ring, std::span<const ReadRequest> requests,
+                 int fd) noexcept
+      : ring_(ring), requests_(requests), fd_(fd) {}
 
   bool await_ready() const noexcept { return false; }
 
-  void await_suspend(cppcoro::coroutine_handle<> handle);
+  // Returns false if all requests completed while they were submitted
+  bool await_suspend(cppcoro::coroutine_handle<> handle) noexcept;
 
   __s32 await_resume() const noexcept { return result_; }
 
-  void SetResult(__s32 result) noexcept { result_ = result; }
+  // Records the result of one request. Returns true if it was the last one.
+  bool SetResult(__s32 result) noexcept {
+    if (result < 0 || result_ < 0) {
+      result_ = result_ < 0 ? result_ : result;
+    } else {
+      result_ += result;
+    }
+    return --num_pending_ == 0;
+  }
 
   cppcoro::coroutine_handle<> GetHandle() const noexcept { return handle_; }
 
  private:
+  void Submit(const ReadRequest &request) noexcept;
+
   cppcoro::coroutine_handle<> handle_;
   IOUring &ring_;
-  void *buffer_;
-  const size_t num_bytes_;
-  const off_t offset_;
+  const ReadRequest request_{};
+  const std::span<const ReadRequest> requests_;
   const int fd_;
-  __s32 result_;
+  unsigned num_pending_{0};
+  __s32 result_{0};
 };
 
 class IOUring {
@@ -56,57 +82,134 @@ class IOUring {
 
   template <size_t kBatchSize = 8>
   void ProcessBatch() noexcept {
+    // resume the requests that completed while entries were submitted
+    if (!completed_handles_.empty()) {
+      auto handles = std::move(completed_handles_);
+      completed_handles_.clear();
+      for (auto handle : handles) {
+        handle.resume();
+      }
+    }
+
     std::array<io_uring_cqe *, kBatchSize> cqes;
     std::array<cppcoro::coroutine_handle<>, kBatchSize> handles;
 
     // collect up to kBatchSize handles
     unsigned num_returned =
         io_uring_peek_batch_cqe(&ring_, cqes.data(), kBatchSize);
+    unsigned num_completed = 0;
     for (unsigned i = 0; i != num_returned; ++i) {
       auto *awaiter =
           reinterpret_cast<IOUringAwaiter *>(io_uring_cqe_get_data(cqes[i]));
-      awaiter->SetResult(cqes[i]->res);
+      bool is_complete = awaiter->SetResult(cqes[i]->res);
       io_uring_cqe_seen(&ring_, cqes[i]);
-      handles[i] = awaiter->GetHandle();
+      if (is_complete) {
+        handles[num_completed++] = awaiter->GetHandle();
+      }
     }
     num_waiting_ -= num_returned;
 
     // resume all collected handles
-    for (unsigned i = 0; i != num_returned; ++i) {
+    for (unsigned i = 0; i != num_completed; ++i) {
       handles[i].resume();
     }
   }
 
-  bool Empty() const noexcept { return num_waiting_ == 0; }
+  bool Empty() const noexcept {
+    return num_waiting_ == 0 && completed_handles_.empty();
+  }
 
  private:
   friend class IOUringAwaiter;
 
-  io_uring ring_;
-  unsigned num_waiting_;
-};
+  // Submits the prepared entries. If the kernel does not accept them until
+  // completions are reaped, waits for a completion and records the completed
+  // requests, whose handles ProcessBatch resumes later. Aborts on any other
+  // error, since the prepared entries refer to suspended awaiters.
+  void SubmitPrepared() noexcept {
+    for (;;) {
+      int result = io_uring_submit(&ring_);
+      if (result >= 0) {
+        return;
+      }
+      unsigned num_in_flight = num_waiting_ - io_uring_sq_ready(&ring_);
+      if ((result != -EBUSY && result != -EAGAIN) || num_in_flight == 0) {
+        Fail("io_uring_submit", result);
+      }
+
+      io_uring_cqe *cqe;
+      result = io_uring_wait_cqe(&ring_, &cqe);
+      if (result < 0 && result != -EINTR) {
+        Fail("io_uring_wait_cqe", result);
+      }
+      RecordCompletions();
+    }
+  }
 
-class SubmissionQueueFullError : public std::exception {
-  [[nodiscard]] const char *what() const noexcept override {
-    return "Submission queue is full";
+  // Like ProcessBatch, but does not resume the completed requests, because
+  // they may be submitted from the coroutine that is being suspended
+  void RecordCompletions() noexcept {
+    std::array<io_uring_cqe *, 8> cqes;
+    unsigned num_returned;
+    while ((num_returned = io_uring_peek_batch_cqe(&ring_, cqes.data(),
+                                                   cqes.size())) != 0) {
+      for (unsigned i = 0; i != num_returned; ++i) {
+        auto *awaiter =
+            reinterpret_cast<IOUringAwaiter *>(io_uring_cqe_get_data(cqes[i]));
+        if (awaiter->SetResult(cqes[i]->res)) {
+          completed_handles_.push_back(awaiter->GetHandle());
+        }
+        io_uring_cqe_seen(&ring_, cqes[i]);
+      }
+      num_waiting_ -= num_returned;
+    }
   }
-};
 
-inline void IOUringAwaiter::await_suspend(cppcoro::coroutine_handle<> handle) {
-  handle_ = handle;
+  [[noreturn]] static void Fail(const char *function, int result) noexcept {
+    std::fprintf(stderr, "%s failed: %s\n", function, std::strerror(-result));
+    std::abort();
+  }
 
-  io_uring_sqe *sqe = io_uring_get_sqe(&ring_.ring_);
-  if (sqe == nullptr) {
-    throw SubmissionQueueFullError{};
+  io_uring ring_;
+  unsigned num_waiting_;
+  std::vector<cppcoro::coroutine_handle<>> completed_handles_;
+};
+
+// Once an entry refers to the awaiter, an exception would leave it dangling.
+// Therefore a full submission queue is not an error: the prepared entries are
+// submitted to make room, also those of a batch that is larger than the queue.
+inline void IOUringAwaiter::Submit(const ReadRequest &request) noexcept {
+  io_uring_sqe *sqe;
+  while ((sqe = io_uring_get_sqe(&ring_.ring_)) == nullptr) {
+    ring_.SubmitPrepared();
   }
 
-  io_uring_prep_read(sqe, fd_, buffer_, num_bytes_, offset_);
+  io_uring_prep_read(sqe, fd_, request.buffer, request.num_bytes,
+                     request.offset);
 
   io_uring_sqe_set_data(sqe, this);
-  io_uring_submit(&ring_.ring_);
+  ++num_pending_;
   ++ring_.num_waiting_;
 }
 
+inline bool IOUringAwaiter::await_suspend(
+    cppcoro::coroutine_handle<> handle) noexcept {
+  handle_ = handle;
+
+  // the extra pending request keeps the requests that complete while later
+  // ones are submitted from resuming the coroutine before it is suspended
+  ++num_pending_;
+  if (requests_.empty()) {
+    Submit(request_);
+  } else {
+    for (const auto &request : requests_) {
+      Submit(request);
+    }
+  }
+  ring_.SubmitPrepared();
+  return --num_pending_ != 0;
+}
+
 class Countdown {
  public:
   explicit Countdown(std::uint64_t counter) noexcept : counter_(counter) {}
@@ -1,116 +1,1088 @@
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <system_error>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "storage/catalog.h"
+#include "storage/column_store.h"
+#include "storage/compression.h"
 #include "storage/file.h"
 #include "storage/find_pattern.h"
 #include "storage/schema.h"
 #include "storage/swip.h"
+#include "storage/tokenizer.h"
 #include "storage/types.h"
+#include "storage/zone_map.h"
 
 namespace {
 
 using namespace storage;
 
-constexpr unsigned kNumThreads = 8u;
-constexpr uint64_t kWriteSize = 1ull << 22;
-static_assert(kWriteSize >= storage::kPageSize);
-constexpr uint64_t kWriteNumPages = kWriteSize / storage::kPageSize;
+// The size of the chunks in which a stream is read
+constexpr uint64_t kStreamChunkSize = 1ull << 24;
+
+// Set by main() before anything is loaded
+struct Options {
+  // 0 stands for one thread per CPU that the process may run on
+  unsigned num_threads{0};
+  // The number of bytes of pages that are written at once
+  uint64_t write_size{1ull << 22};
+} options;
+
+// At least one page is written at once
+template <typename Page>
+static uint64_t GetWriteNumPages() noexcept {
+  return std::max<uint64_t>(options.write_size / sizeof(Page), 1);
+}
+
+// The time that all threads together spent on parsing and on writing
+struct PhaseTimes {
+  std::atomic<uint64_t> parse_nanoseconds{0};
+  std::atomic<uint64_t> write_nanoseconds{0};
+  std::atomic<uint64_t> num_written_bytes{0};
+} phase_times;
+
+// The time that the current thread spent on writing
+thread_local uint64_t thread_write_nanoseconds = 0;
+
+static uint64_t GetNanosecondsSince(
+    std::chrono::steady_clock::time_point start_time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start_time)
+      .count();
+}
+
+// Adds the time from its construction to Stop() that the thread did not spend
+// on writing to the parse time
+class ParseTimer {
+ public:
+  ParseTimer() noexcept
+      : start_time_(std::chrono::steady_clock::now()),
+        start_write_nanoseconds_(thread_write_nanoseconds) {}
+
+  void Stop() noexcept {
+    phase_times.parse_nanoseconds +=
+        GetNanosecondsSince(start_time_) -
+        (thread_write_nanoseconds - start_write_nanoseconds_);
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_time_;
+  uint64_t start_write_nanoseconds_;
+};
+
+static void MeasuredWriteBlock(storage::File &file, const std::byte *data,
+                               size_t offset, size_t size) {
+  auto start_time = std::chrono::steady_clock::now();
+  file.WriteBlock(data, offset, size);
+  auto nanoseconds = GetNanosecondsSince(start_time);
+  thread_write_nanoseconds += nanoseconds;
+  phase_times.write_nanoseconds += nanoseconds;
+  phase_times.num_written_bytes += size;
+}
 
 template <typename Page>
-static const char *InsertLine(const char *begin, const char *end,
-                              uint64_t index, Page &page);
-
-template <>
-const char *InsertLine<LineitemPageQ1>(const char *begin, const char *end,
-                                       uint64_t index, LineitemPageQ1 &page) {
-  auto iter = FindNthPatternFast<'|'>(begin, end, 4) + 1;
-  auto parsed_quantity = storage::Numeric<12, 2>::FromString(iter, '|');
-  page.l_quantity[index] = parsed_quantity.value;
-  auto parsed_extendedprice =
-      storage::Numeric<12, 2>::FromString(parsed_quantity.end_it + 1, '|');
-  page.l_extendedprice[index] = parsed_extendedprice.value;
-  auto parsed_discount =
-      storage::Numeric<12, 2>::FromString(parsed_extendedprice.end_it + 1, '|');
-  page.l_discount[index] = parsed_discount.value;
-  auto parsed_tax =
-      storage::Numeric<12, 2>::FromString(parsed_discount.end_it + 1, '|');
-  page.l_tax[index] = parsed_tax.value;
-  iter = parsed_tax.end_it + 1;
-  page.l_returnflag[index] = *iter;
-  iter += 2;
-  page.l_linestatus[index] = *iter;
-  iter += 2;
-  page.l_shipdate[index] = storage::Date::FromString(iter, '|').value;
-  return FindPatternFast<'\n'>(iter, end);
-}
-
-template <>
-const char *InsertLine<LineitemPageQ14>(const char *begin, const char *end,
-                                        uint64_t index, LineitemPageQ14 &page) {
-  auto iter = FindPatternSlow<'|'>(begin, end) + 1;
-  auto parsed_partkey = storage::Integer::FromString(iter, '|');
-  page.l_partkey[index] = parsed_partkey.value;
-  iter = FindNthPatternFast<'|'>(parsed_partkey.end_it + 1, end, 3) + 1;
-  auto parsed_extendedprice = storage::Numeric<12, 2>::FromString(iter, '|');
-  page.l_extendedprice[index] = parsed_extendedprice.value;
-  auto parsed_discount =
-      storage::Numeric<12, 2>::FromString(parsed_extendedprice.end_it + 1, '|');
-  page.l_discount[index] = parsed_discount.value;
-  iter = FindNthPatternFast<'|'>(parsed_discount.end_it + 1, end, 3) + 1;
-  page.l_shipdate[index] = storage::Date::FromString(iter, '|').value;
-  return FindPatternFast<'\n'>(iter, end);
-}
-
-template <>
-const char *InsertLine<PartPage>(const char *begin, const char *end,
-                                 uint64_t index, PartPage &page) {
-  auto parsed_partkey = storage::Integer::FromString(begin, '|');
-  page.p_partkey[index] = parsed_partkey.value;
-  auto type_begin =
-      FindNthPatternFast<'|'>(parsed_partkey.end_it + 1, end, 3) + 1;
-  auto type_end = FindPatternFast<'|'>(type_begin, end);
-  new (&page.p_type[index]) typeof(page.p_type[index]){type_begin, type_end};
-  return FindPatternFast<'\n'>(type_end + 1, end);
+static void MeasuredWritePages(storage::File &file, PageIndex first_page_index,
+                               const Page *pages, size_t num_pages) {
+  MeasuredWriteBlock(file, reinterpret_cast<const std::byte *>(pages),
+                     File::GetPageOffset(first_page_index, sizeof(Page)),
+                     sizeof(Page) * num_pages);
 }
 
+// Prints the throughput of every phase per thread, i.e. the number of bytes
+// that a thread parses or writes per second
+static void PrintPhaseThroughputs(uint64_t num_input_bytes) {
+  if (phase_times.parse_nanoseconds != 0) {
+    std::cout << "Parsed "
+              << num_input_bytes / double(phase_times.parse_nanoseconds)
+              << " GB/s per thread\n";
+  }
+  if (phase_times.write_nanoseconds != 0) {
+    std::cout << "Wrote "
+              << phase_times.num_written_bytes /
+                     double(phase_times.write_nanoseconds)
+              << " GB/s per thread\n";
+  }
+}
+
+template <typename T>
+struct IsVarchar : std::false_type {};
+
+template <unsigned kMaxLen>
+struct IsVarchar<Varchar<kMaxLen>> : std::true_type {};
+
+// Parses the value of the field [begin, end). The parsers of the other types
+// read the 8 bytes in front of end, so they are only used if these bytes belong
+// to the input that starts at input_begin.
+template <typename T>
+static T ParseField(const char *begin, const char *end,
+                    const char *input_begin) {
+  if constexpr (std::is_same_v<T, Char>) {
+    return *begin;
+  } else if constexpr (IsVarchar<T>::value) {
+    return T{begin, end};
+  } else if constexpr (std::is_same_v<T, Date>) {
+    return T::FromField(begin, end);
+  } else {
+    if (end - input_begin >= 8) {
+      return T::FromField(begin, end);
+    }
+    return T::FromString(begin, *end).value;
+  }
+}
+
+// Parses the field of the current line of the tokenizer that belongs to the
+// kIndex-th column of the page and stores it at the given tuple index
+template <typename Page, size_t kIndex>
+static void InsertField(const Tokenizer &tokenizer, uint64_t index,
+                        Page &page) {
+  constexpr size_t kTableFieldIndex =
+      Page::kTable.IndexOf(Page::kColumnNames[kIndex]);
+  static_assert(kTableFieldIndex < Page::kTable.column_names.size(),
+                "The column does not belong to the table of the page");
+  static_assert(kTableFieldIndex < Tokenizer::kMaxNumFields);
+
+  page.template Get<kIndex>()[index] =
+      ParseField<typename Page::template ColumnType<kIndex>>(
+          tokenizer.GetFieldBegin(kTableFieldIndex),
+          tokenizer.GetFieldEnd(kTableFieldIndex), tokenizer.GetBegin());
+}
+
+// Parses the fields of the current line of the tokenizer into the tuple with
+// the given index
+template <typename Page>
+static void InsertFields(const Tokenizer &tokenizer, uint64_t index,
+                         Page &page) {
+  [&]<size_t... kIndexes>(std::index_sequence<kIndexes...>) {
+    (InsertField<Page, kIndexes>(tokenizer, index, page), ...);
+  }(std::make_index_sequence<Page::kNumColumns>{});
+}
+
+// Parses the next line of the tokenizer into the tuple with the given index
+template <typename Page>
+static void InsertLine(Tokenizer &tokenizer, uint64_t index, Page &page) {
+  tokenizer.NextLine();
+  InsertFields(tokenizer, index, page);
+}
+
+// Collects filled pages and passes them in batches to
+// write_pages(pages, num_pages)
+template <typename Page>
+class PageBatch {
+ public:
+  using WritePageBatch = std::function<void(const Page *, uint64_t)>;
+
+  explicit PageBatch(WritePageBatch write_pages)
+      : pages_(GetWriteNumPages<Page>()),
+        write_pages_(std::move(write_pages)) {}
+
+  // The page that is filled next
+  Page &GetNextPage() noexcept { return pages_[num_used_pages_]; }
+
+  // Adds the next page to the batch once it is filled
+  void Push() {
+    if (++num_used_pages_ == pages_.size()) {
+      Flush();
+    }
+  }
+
+  void Flush() {
+    if (num_used_pages_ != 0) {
+      write_pages_(pages_.data(), num_used_pages_);
+      num_used_pages_ = 0;
+    }
+  }
+
+ private:
+  std::vector<Page> pages_;
+  uint64_t num_used_pages_{0};
+  WritePageBatch write_pages_;
+};
+
+// Fills pages with the tuples that are added one after the other
+template <typename Page>
+class PageBuilder {
+ public:
+  explicit PageBuilder(typename PageBatch<Page>::WritePageBatch write_pages)
+      : batch_(std::move(write_pages)) {}
+
+  // insert_tuple(page, tuple_index) stores the tuple at the given index
+  template <typename InsertTuple>
+  void Add(InsertTuple &&insert_tuple) {
+    insert_tuple(batch_.GetNextPage(), num_tuples_);
+    if (++num_tuples_ == Page::kMaxNumTuples) {
+      FinishPage();
+    }
+  }
+
+  // Continues to fill a partially filled page
+  void Resume(const Page &page) {
+    batch_.GetNextPage() = page;
+    num_tuples_ = page.num_tuples;
+  }
+
+  // Writes the remaining pages
+  void Finish() {
+    if (num_tuples_ != 0) {
+      FinishPage();
+    }
+    batch_.Flush();
+  }
+
+ private:
+  void FinishPage() {
+    batch_.GetNextPage().num_tuples = num_tuples_;
+    num_tuples_ = 0;
+    batch_.Push();
+  }
+
+  PageBatch<Page> batch_;
+  uint32_t num_tuples_{0};
+};
+
+// Inserts the tuples into a staging area and compresses as many of them as fit
+// into each page
 template <typename Page>
-static void LoadChunk(const char *begin, const char *end,
-                      storage::File &data_file) {
-  std::vector<Page> data(kWriteNumPages);
-
-  while (begin < end) {
-    for (uint64_t i = 0; i != kWriteNumPages; ++i) {
-      auto &page = data[i];
-      uint64_t tuple_index = 0;
-      for (; tuple_index != Page::kMaxNumTuples && begin < end; ++tuple_index) {
-        begin = InsertLine<Page>(begin, end, tuple_index, page) + 1;
+class PageBuilder<CompressedPage<Page>> {
+  using Staging = typename CompressedPage<Page>::Staging;
+
+ public:
+  explicit PageBuilder(
+      typename PageBatch<CompressedPage<Page>>::WritePageBatch write_pages)
+      : batch_(std::move(write_pages)), staging_(std::make_unique<Staging>()) {}
+
+  template <typename InsertTuple>
+  void Add(InsertTuple &&insert_tuple) {
+    insert_tuple(*staging_, num_staged_tuples_);
+    if (++num_staged_tuples_ == Staging::kMaxNumTuples) {
+      CompressPage();
+    }
+  }
+
+  // Compresses the tuples of the page again together with the next ones
+  void Resume(const CompressedPage<Page> &page) {
+    num_staged_tuples_ = page.DecodeBlock(0, *staging_);
+  }
+
+  void Finish() {
+    while (num_staged_tuples_ != 0) {
+      CompressPage();
+    }
+    batch_.Flush();
+  }
+
+ private:
+  void CompressPage() {
+    auto num_compressed_tuples =
+        batch_.GetNextPage().Compress(*staging_, 0, num_staged_tuples_);
+    staging_->RemoveFirst(num_compressed_tuples, num_staged_tuples_);
+    num_staged_tuples_ -= num_compressed_tuples;
+    batch_.Push();
+  }
+
+  PageBatch<CompressedPage<Page>> batch_;
+  std::unique_ptr<Staging> staging_;
+  uint32_t num_staged_tuples_{0};
+};
+
+// Returns a function that writes batches of pages to consecutive positions of
+// the data file, starting with the page with the given index
+template <typename Page>
+static auto WritePagesFrom(storage::File &data_file,
+                           PageIndex first_page_index) {
+  return [&data_file, page_index = first_page_index](
+             const Page *pages, uint64_t num_pages) mutable {
+    MeasuredWritePages(data_file, page_index, pages, num_pages);
+    page_index += num_pages;
+  };
+}
+
+// The CPUs that the process may run on
+static const std::vector<int> &GetAllowedCpus() {
+  static const std::vector<int> kCpus = []() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (int cpu = 0; cpu != CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+          cpus.push_back(cpu);
+        }
       }
-      page.num_tuples = tuple_index;
-      if (begin >= end) {
-        // we have reached the end of our chunk
-        // write the remaining pages
-        auto num_used_pages = i + 1;
-        data_file.AppendPages(reinterpret_cast<const std::byte *>(data.data()),
-                              num_used_pages);
-        return;
+    }
+    return cpus;
+  }();
+  return kCpus;
+}
+
+static void PinToCpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Calls f(index) on options.num_threads threads and waits for them. Every
+// thread is pinned to its own CPU before it calls f, so the pages that it
+// allocates and fills first, e.g. its page batches, come from the memory of
+// its NUMA node.
+template <typename F>
+static void RunOnThreads(F &&f) {
+  const auto &cpus = GetAllowedCpus();
+  std::vector<std::thread> threads;
+  threads.reserve(options.num_threads);
+  for (unsigned index = 0; index != options.num_threads; ++index) {
+    threads.emplace_back([&f, &cpus, index]() {
+      if (!cpus.empty()) {
+        PinToCpu(cpus[index % cpus.size()]);
       }
+      f(index);
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// Splits the lines into one range per thread. Returns the beginnings of the
+// ranges followed by end.
+static std::vector<const char *> SplitLines(const char *begin,
+                                            const char *end) {
+  std::vector<const char *> boundaries(options.num_threads + 1);
+  for (unsigned index = 0; index <= options.num_threads; ++index) {
+    boundaries[index] = std::min(
+        FindBeginBoundary<'\n'>(begin, end, options.num_threads, index), end);
+  }
+  return boundaries;
+}
+
+static uint64_t CountLines(const char *begin, const char *end) {
+  uint64_t num_lines = std::count(begin, end, '\n');
+  // the last line may lack its newline character
+  return num_lines + (begin != end && end[-1] != '\n');
+}
+
+// Returns the index of the first page or row group of every range followed by
+// the total number of them
+static std::vector<uint64_t> GetFirstIndexes(std::span<const uint64_t> counts) {
+  std::vector<uint64_t> first_indexes(counts.size() + 1);
+  for (size_t index = 0; index != counts.size(); ++index) {
+    first_indexes[index + 1] = first_indexes[index] + counts[index];
+  }
+  return first_indexes;
+}
+
+// Compressed pages are parsed into uncompressed pages with the same columns
+template <typename Page>
+struct ParsedPageOf {
+  using Type = Page;
+};
+
+template <typename Page>
+struct ParsedPageOf<CompressedPage<Page>> {
+  using Type = Page;
+};
+
+// Calls f with the column index as std::integral_constant
+template <typename Page, typename F>
+static void VisitColumn(size_t column_index, F &&f) {
+  [&]<size_t... kIndexes>(std::index_sequence<kIndexes...>) {
+    ((kIndexes == column_index
+          ? f(std::integral_constant<size_t, kIndexes>{})
+          : void()),
+     ...);
+  }(std::make_index_sequence<Page::kNumColumns>{});
+}
+
+template <typename Source, typename Target>
+static void CopyTuple(const Source &source, uint32_t source_index,
+                      Target &target, uint64_t target_index) {
+  [&]<size_t... kIndexes>(std::index_sequence<kIndexes...>) {
+    ((target.template Get<kIndexes>()[target_index] =
+          source.template Get<kIndexes>()[source_index]),
+     ...);
+  }(std::make_index_sequence<Source::kNumColumns>{});
+}
+
+// Parses the lines into completely filled pages, only the last page may be
+// partially filled
+template <typename Page>
+static std::vector<Page> ParseChunk(const char *begin, const char *end) {
+  std::vector<Page> pages;
+  Tokenizer tokenizer{begin, end};
+  while (!tokenizer.IsAtEnd()) {
+    auto &page = pages.emplace_back();
+    uint64_t tuple_index = 0;
+    for (; tuple_index != Page::kMaxNumTuples && !tokenizer.IsAtEnd();
+         ++tuple_index) {
+      InsertLine(tokenizer, tuple_index, page);
     }
-    data_file.AppendPages(reinterpret_cast<const std::byte *>(data.data()),
-                          kWriteNumPages);
+    page.num_tuples = tuple_index;
   }
+  return pages;
 }
 
+// Sorts the values stably with options.num_threads threads: every thread sorts
+// one run, then adjacent runs are merged pairwise in parallel until one run is
+// left
+template <typename T, typename Compare>
+static void ParallelStableSort(std::vector<T> &values, Compare compare) {
+  std::vector<size_t> run_begins;
+  for (unsigned i = 0; i <= options.num_threads; ++i) {
+    run_begins.push_back(values.size() * i / options.num_threads);
+  }
+
+  RunOnThreads([&](unsigned index) {
+    std::stable_sort(values.begin() + run_begins[index],
+                     values.begin() + run_begins[index + 1], compare);
+  });
+
+  std::vector<std::thread> threads;
+  while (run_begins.size() > 2) {
+    threads.clear();
+    std::vector<size_t> merged_run_begins;
+    size_t i = 0;
+    for (; i + 2 < run_begins.size(); i += 2) {
+      merged_run_begins.push_back(run_begins[i]);
+      threads.emplace_back([&values, &compare, begin = run_begins[i],
+                            middle = run_begins[i + 1],
+                            end = run_begins[i + 2]]() {
+        std::inplace_merge(values.begin() + begin, values.begin() + middle,
+                           values.begin() + end, compare);
+      });
+    }
+    if (i + 2 == run_begins.size()) {
+      // an odd run at the end is merged in the next round
+      merged_run_begins.push_back(run_begins[i]);
+    }
+    merged_run_begins.push_back(run_begins.back());
+    for (auto &t : threads) {
+      t.join();
+    }
+    run_begins = std::move(merged_run_begins);
+  }
+}
+
+template <typename Page>
+struct TupleReference {
+  int64_t key;
+  const Page *page;
+  uint32_t tuple_index;
+};
+
+// Parses all lines, sorts the tuples stably by the given column and writes them
+// in this order. Unlike LoadChunks(), this keeps the whole relation in memory.
 template <typename Page>
-static void LoadFile(const char *path_to_data_in,
-                     const char *path_to_data_out) {
+static void LoadClustered(const char *begin, const char *end,
+                          size_t column_index, storage::File &data_file) {
+  using Parsed = typename ParsedPageOf<Page>::Type;
+
+  auto boundaries = SplitLines(begin, end);
+  std::vector<std::vector<Parsed>> chunks(options.num_threads);
+  RunOnThreads([&](unsigned index) {
+    ParseTimer parse_timer;
+    chunks[index] =
+        ParseChunk<Parsed>(boundaries[index], boundaries[index + 1]);
+    parse_timer.Stop();
+  });
+
+  std::vector<uint64_t> chunk_offsets{0};
+  for (const auto &chunk : chunks) {
+    uint64_t num_tuples = 0;
+    for (const auto &page : chunk) {
+      num_tuples += page.num_tuples;
+    }
+    chunk_offsets.push_back(chunk_offsets.back() + num_tuples);
+  }
+
+  std::vector<TupleReference<Parsed>> references(chunk_offsets.back());
+  RunOnThreads([&](unsigned index) {
+    auto *reference = &references[chunk_offsets[index]];
+    VisitColumn<Parsed>(column_index, [&](auto column) {
+      using T = typename Parsed::template ColumnType<column>;
+      if constexpr (!IsVarchar<T>::value) {
+        for (const auto &page : chunks[index]) {
+          auto values = page.template Get<column>();
+          for (uint32_t i = 0; i != page.num_tuples; ++i) {
+            *reference++ = {detail::ToRaw(values[i]), &page, i};
+          }
+        }
+      }
+    });
+  });
+
+  ParallelStableSort(references, [](const auto &lhs, const auto &rhs) {
+    return lhs.key < rhs.key;
+  });
+
+  PageBuilder<Page> builder{WritePagesFrom<Page>(data_file, 0)};
+  for (const auto &reference : references) {
+    builder.Add([&reference](auto &page, uint64_t tuple_index) {
+      CopyTuple(*reference.page, reference.tuple_index, page, tuple_index);
+    });
+  }
+  builder.Finish();
+}
+
+// Opens the .tbl file, - stands for stdin
+static int OpenInput(const char *path_to_data_in) {
+  if (std::string_view{path_to_data_in} == "-") {
+    return STDIN_FILENO;
+  }
   int fd = open(path_to_data_in, O_RDONLY);
+  if (fd < 0) {
+    throw std::system_error{errno, std::system_category(), path_to_data_in};
+  }
+  return fd;
+}
+
+// A regular file is mapped into memory, anything else, e.g. a pipe, is read
+// as a stream
+static bool IsRegularFile(int fd) {
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) < 0) {
+    throw std::system_error{errno, std::system_category()};
+  }
+  return S_ISREG(file_stat.st_mode);
+}
+
+// Reads until size bytes are read or the end of the input is reached and
+// returns the number of bytes read
+static size_t ReadFully(int fd, char *data, size_t size) {
+  size_t total_bytes_read = 0;
+  while (total_bytes_read < size) {
+    ssize_t bytes_read =
+        read(fd, data + total_bytes_read, size - total_bytes_read);
+    if (bytes_read == 0) {
+      break;
+    }
+    if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error{errno, std::system_category()};
+    }
+    total_bytes_read += bytes_read;
+  }
+  return total_bytes_read;
+}
+
+static std::string ReadAll(int fd) {
+  std::string input;
+  size_t size = 0;
+  do {
+    input.resize(std::max<size_t>(2 * input.size(), kStreamChunkSize));
+    size += ReadFully(fd, input.data() + size, input.size() - size);
+  } while (size == input.size());
+  input.resize(size);
+  return input;
+}
+
+// Whole lines of the input, the sequence number gives their position
+struct StreamChunk {
+  uint64_t sequence;
+  std::unique_ptr<char[]> data;
+  size_t size;
+};
+
+// A queue with a limited capacity: Push() waits while the queue is full and
+// Pop() waits while it is empty. Pop() returns nothing once the queue is
+// closed and empty.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+  void Push(T value) {
+    std::unique_lock lock{mutex_};
+    not_full_.wait(lock, [this]() { return values_.size() < capacity_; });
+    values_.push_back(std::move(value));
+    not_empty_.notify_one();
+  }
+
+  std::optional<T> Pop() {
+    std::unique_lock lock{mutex_};
+    not_empty_.wait(lock, [this]() { return !values_.empty() || closed_; });
+    if (values_.empty()) {
+      return std::nullopt;
+    }
+    T value = std::move(values_.front());
+    values_.pop_front();
+    not_full_.notify_one();
+    return value;
+  }
+
+  void Close() {
+    std::lock_guard lock{mutex_};
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> values_;
+  size_t capacity_;
+  bool closed_{false};
+};
+
+// Hands out the positions of the pages of the chunks in the order of the
+// chunks, i.e. a chunk has to wait until all chunks in front of it got their
+// positions
+class PagePlacement {
+ public:
+  explicit PagePlacement(PageIndex first_page_index = 0) noexcept
+      : next_page_index_(first_page_index) {}
+
+  PageIndex Reserve(uint64_t sequence, uint64_t num_pages) {
+    std::unique_lock lock{mutex_};
+    turn_.wait(lock, [&]() { return next_sequence_ == sequence; });
+    auto first_page_index = next_page_index_;
+    next_page_index_ += num_pages;
+    ++next_sequence_;
+    turn_.notify_all();
+    return first_page_index;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable turn_;
+  uint64_t next_sequence_{0};
+  PageIndex next_page_index_;
+};
+
+// Reads chunks of kStreamChunkSize bytes that end with a complete line. The
+// incomplete line at the end of a chunk is moved to the beginning of the next
+// one.
+static void ReadChunks(int fd, BoundedQueue<StreamChunk> &queue) {
+  std::string remainder;
+  for (uint64_t sequence = 0;; ++sequence) {
+    StreamChunk chunk{sequence,
+                      std::make_unique_for_overwrite<char[]>(kStreamChunkSize),
+                      remainder.size()};
+    std::memcpy(chunk.data.get(), remainder.data(), remainder.size());
+    chunk.size += ReadFully(fd, chunk.data.get() + chunk.size,
+                            kStreamChunkSize - chunk.size);
+    bool is_last = chunk.size != kStreamChunkSize;
+
+    remainder.clear();
+    if (!is_last) {
+      auto *data_end = chunk.data.get() + chunk.size;
+      auto *line_end = std::find(std::make_reverse_iterator(data_end),
+                                 std::make_reverse_iterator(chunk.data.get()),
+                                 '\n')
+                           .base();
+      if (line_end == chunk.data.get()) {
+        throw std::runtime_error{"A line does not fit into a chunk"};
+      }
+      remainder.assign(line_end, data_end);
+      chunk.size = line_end - chunk.data.get();
+    }
+    if (chunk.size != 0) {
+      queue.Push(std::move(chunk));
+    }
+    if (is_last) {
+      break;
+    }
+  }
+  queue.Close();
+}
+
+// Inserts the lines of one range of the input into the pages of one data file
+class RangeWriter {
+ public:
+  virtual ~RangeWriter() = default;
+
+  // Inserts the current line of the tokenizer
+  virtual void AddLine(const Tokenizer &tokenizer) = 0;
+
+  // Writes the remaining pages of the range
+  virtual void Finish() = 0;
+};
+
+// Loads one data file. The input is split into ranges of lines that are loaded
+// in parallel. The pages of a range are written behind those of the preceding
+// ranges, so the pages are in the order of the lines in the input, no matter
+// how the threads are scheduled.
+class DataFileWriter {
+ public:
+  virtual ~DataFileWriter() = default;
+
+  // Called before the ranges are loaded if their numbers of lines are known
+  virtual void PlanRanges(std::span<const uint64_t> range_num_lines) = 0;
+
+  // The ranges are numbered in the order of the input, every range has to be
+  // finished
+  virtual std::unique_ptr<RangeWriter> MakeRangeWriter(
+      uint64_t range_index) = 0;
+
+  // Loads all lines at once sorted by the given column
+  virtual void LoadClusteredBy(const char *begin, const char *end,
+                               std::string_view cluster_by) = 0;
+
+  // Writes the zone map and the catalog once all pages are written
+  virtual void Finish() = 0;
+};
+
+// Writes a data file with pages of type Page
+template <typename Page>
+class PageFileWriter final : public DataFileWriter {
+ public:
+  // Overwrites the data file unless append is set. Then the tuples are appended
+  // to an existing data file: the first range continues to fill its last page,
+  // and the other pages follow it.
+  PageFileWriter(std::string path, bool append)
+      : path_(std::move(path)),
+        data_file_(path_.c_str(), append ? File::kUpdate : File::kWrite),
+        first_page_index_(append ? ResumeLastPage() : WriteHeader()),
+        placement_(first_page_index_) {}
+
+  // An uncompressed page holds a fixed number of tuples, so the positions of
+  // the pages of a range follow from the numbers of lines of the preceding
+  // ranges. The number of compressed pages is only known after compressing.
+  void PlanRanges(std::span<const uint64_t> range_num_lines) override {
+    if constexpr (!IsCompressedPage<Page>::value) {
+      std::vector<uint64_t> num_pages(range_num_lines.size());
+      for (size_t index = 0; index != num_pages.size(); ++index) {
+        uint64_t num_tuples = range_num_lines[index];
+        if (index == 0 && last_page_) {
+          num_tuples += last_page_->num_tuples;
+        }
+        num_pages[index] =
+            (num_tuples + Page::kMaxNumTuples - 1) / Page::kMaxNumTuples;
+      }
+      first_page_indexes_ = GetFirstIndexes(num_pages);
+      for (auto &first_page_index : first_page_indexes_) {
+        first_page_index += first_page_index_;
+      }
+      data_file_.Allocate(
+          File::GetPageOffset(first_page_indexes_.back(), sizeof(Page)));
+    }
+  }
+
+  std::unique_ptr<RangeWriter> MakeRangeWriter(uint64_t range_index) override {
+    return std::make_unique<Range>(*this, range_index);
+  }
+
+  void LoadClusteredBy(const char *begin, const char *end,
+                       std::string_view cluster_by) override {
+    using Parsed = typename ParsedPageOf<Page>::Type;
+    auto cluster_by_index = Parsed::IndexOf(cluster_by);
+    bool is_valid = false;
+    VisitColumn<Parsed>(cluster_by_index, [&is_valid](auto column) {
+      is_valid =
+          !IsVarchar<typename Parsed::template ColumnType<column>>::value;
+    });
+    if (!is_valid) {
+      throw std::invalid_argument{"Unable to cluster by " +
+                                  std::string{cluster_by}};
+    }
+    if (catalog_) {
+      throw std::invalid_argument{"Appended tuples cannot be clustered"};
+    }
+    LoadClustered<Page>(begin, end, cluster_by_index, data_file_);
+  }
+
+  // After appending, only the entries of the rewritten last page and of the
+  // new pages are computed
+  void Finish() override {
+    if (catalog_) {
+      ZoneMap zone_map = ZoneMap::ReadFor(path_.c_str(), Page::kNumColumns);
+      zone_map.Update<Page>(path_.c_str(), first_page_index_);
+      zone_map.WriteFor(path_.c_str());
+      catalog_->Update<Page>(path_.c_str(), first_page_index_);
+      catalog_->WriteFor(path_.c_str());
+    } else {
+      ZoneMap::Compute<Page>(path_.c_str()).WriteFor(path_.c_str());
+      Catalog::Compute<Page>(path_.c_str()).WriteFor(path_.c_str());
+    }
+  }
+
+ private:
+  // Returns the index of the first page
+  PageIndex WriteHeader() {
+    data_file_.AppendHeader(DataFileHeader::For<Page>());
+    return 0;
+  }
+
+  // Reads the last page unless it is full and returns the index of the first
+  // page that is written. The catalog tells whether the file consists of
+  // pages of type Page. A compressed page is always read, its tuples are
+  // compressed again together with the appended ones.
+  PageIndex ResumeLastPage() {
+    catalog_ = Catalog::ReadFor<Page>(path_.c_str());
+    auto num_pages = catalog_->GetNumPages();
+    if (data_file_.GetNumPages(sizeof(Page)) != num_pages) {
+      throw std::runtime_error{path_ + " does not match its catalog"};
+    }
+    if (num_pages == 0) {
+      return 0;
+    }
+    auto num_tuples = catalog_->GetNumTuples(num_pages - 1);
+    if (num_tuples == 0 || (!IsCompressedPage<Page>::value &&
+                            num_tuples == Page::kMaxNumTuples)) {
+      return num_pages;
+    }
+    last_page_ = std::make_unique<Page>();
+    data_file_.ReadPage(num_pages - 1, last_page_.get());
+    return num_pages - 1;
+  }
+
+  // Writes the pages of a planned range to their final positions right away.
+  // The pages of any other range are kept in memory until all ranges in front
+  // of it got their positions.
+  class Range final : public RangeWriter {
+   public:
+    Range(PageFileWriter &file_writer, uint64_t range_index)
+        : file_writer_(file_writer),
+          range_index_(range_index),
+          builder_([this](const Page *pages, uint64_t num_pages) {
+            WritePages(pages, num_pages);
+          }) {
+      if (range_index == 0 && file_writer.last_page_) {
+        builder_.Resume(*file_writer.last_page_);
+      }
+      if (range_index + 1 < file_writer.first_page_indexes_.size()) {
+        next_page_index_ = file_writer.first_page_indexes_[range_index];
+      }
+    }
+
+    void AddLine(const Tokenizer &tokenizer) override {
+      builder_.Add([&tokenizer](auto &page, uint64_t tuple_index) {
+        InsertFields(tokenizer, tuple_index, page);
+      });
+    }
+
+    void Finish() override {
+      builder_.Finish();
+      if (!next_page_index_) {
+        MeasuredWritePages(
+            file_writer_.data_file_,
+            file_writer_.placement_.Reserve(range_index_, pages_.size()),
+            pages_.data(), pages_.size());
+      }
+    }
+
+   private:
+    void WritePages(const Page *pages, uint64_t num_pages) {
+      if (next_page_index_) {
+        MeasuredWritePages(file_writer_.data_file_, *next_page_index_, pages,
+                           num_pages);
+        *next_page_index_ += num_pages;
+      } else {
+        pages_.insert(pages_.end(), pages, pages + num_pages);
+      }
+    }
+
+    PageFileWriter &file_writer_;
+    uint64_t range_index_;
+    PageBuilder<Page> builder_;
+    std::optional<PageIndex> next_page_index_;
+    std::vector<Page> pages_;
+  };
+
+  std::string path_;
+  storage::File data_file_;
+  // Set when appending, initialized before first_page_index_
+  std::optional<Catalog> catalog_;
+  std::unique_ptr<Page> last_page_;
+  // The index of the first page that is written
+  PageIndex first_page_index_;
+  // The first page of every planned range followed by the end of the pages
+  std::vector<PageIndex> first_page_indexes_;
+  PagePlacement placement_;
+};
+
+using DataFileWriters = std::span<const std::unique_ptr<DataFileWriter>>;
+
+// Tokenizes every line of the range once and inserts it into the pages of all
+// data files
+static void LoadRange(const char *begin, const char *end, uint64_t range_index,
+                      DataFileWriters writers) {
+  std::vector<std::unique_ptr<RangeWriter>> ranges;
+  for (const auto &writer : writers) {
+    ranges.push_back(writer->MakeRangeWriter(range_index));
+  }
+
+  ParseTimer parse_timer;
+  Tokenizer tokenizer{begin, end};
+  while (!tokenizer.IsAtEnd()) {
+    tokenizer.NextLine();
+    for (const auto &range : ranges) {
+      range->AddLine(tokenizer);
+    }
+  }
+  parse_timer.Stop();
+
+  for (const auto &range : ranges) {
+    range->Finish();
+  }
+}
+
+// Every thread loads one range of lines
+static void LoadChunks(const char *begin, const char *end,
+                       DataFileWriters writers) {
+  auto boundaries = SplitLines(begin, end);
+  std::vector<uint64_t> num_lines(options.num_threads);
+  RunOnThreads([&](unsigned index) {
+    num_lines[index] = CountLines(boundaries[index], boundaries[index + 1]);
+  });
+
+  for (const auto &writer : writers) {
+    writer->PlanRanges(num_lines);
+  }
+  RunOnThreads([&](unsigned index) {
+    LoadRange(boundaries[index], boundaries[index + 1], index, writers);
+  });
+}
+
+// Loads the lines that are read from a stream, e.g. a pipe from dbgen, without
+// storing them in between. One thread reads the stream in chunks, the other
+// threads load one chunk after the other as a range. The data files are the
+// same as for a regular file apart from the partially filled page at the end
+// of every chunk. Returns the number of bytes read.
+static uint64_t LoadStream(int fd, DataFileWriters writers) {
+  BoundedQueue<StreamChunk> queue{options.num_threads};
+  std::atomic<uint64_t> num_bytes{0};
+
+  std::thread reader{[fd, &queue]() { ReadChunks(fd, queue); }};
+  RunOnThreads([&](unsigned) {
+    while (auto chunk = queue.Pop()) {
+      num_bytes += chunk->size;
+      LoadRange(chunk->data.get(), chunk->data.get() + chunk->size,
+                chunk->sequence, writers);
+    }
+  });
+  reader.join();
+  return num_bytes;
+}
+
+// Loads all data files in a single pass over the input, so every line is read
+// and tokenized only once. Clusters the tuples by the column cluster_by unless
+// it is empty, which is only supported for a single data file.
+static void LoadFiles(const char *path_to_data_in, DataFileWriters writers,
+                      std::string_view cluster_by) {
+  if (!cluster_by.empty() && writers.size() != 1) {
+    throw std::invalid_argument{"Only a single data file can be clustered"};
+  }
+
+  int fd = OpenInput(path_to_data_in);
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  uint64_t length;
+  if (IsRegularFile(fd)) {
+    length = lseek(fd, 0, SEEK_END);
+
+    void *data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    madvise(data, length, MADV_SEQUENTIAL);
+    madvise(data, length, MADV_WILLNEED);
+
+    auto begin = static_cast<const char *>(data);
+    auto end = begin + length;
+    if (cluster_by.empty()) {
+      LoadChunks(begin, end, writers);
+    } else {
+      writers.front()->LoadClusteredBy(begin, end, cluster_by);
+    }
+    munmap(data, length);
+  } else if (cluster_by.empty()) {
+    length = LoadStream(fd, writers);
+  } else {
+    // clustering keeps the whole relation in memory anyway
+    auto input = ReadAll(fd);
+    length = input.size();
+    writers.front()->LoadClusteredBy(input.data(), input.data() + input.size(),
+                                     cluster_by);
+  }
+
+  auto end_time = std::chrono::steady_clock::now();
+  double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           end_time - start_time)
+                           .count();
+  std::cout << "Processed " << length / nanoseconds << " GB/s\n";
+  PrintPhaseThroughputs(length);
+
+  if (fd != STDIN_FILENO) {
+    close(fd);
+  }
+
+  for (const auto &writer : writers) {
+    writer->Finish();
+  }
+}
+
+// Parses the lines into row groups and writes every column of the i-th row
+// group to position first_row_group + i of the column's file
+template <typename Group>
+static void LoadColumnsChunk(
+    const char *begin, const char *end, uint64_t first_row_group,
+    std::span<const std::unique_ptr<storage::File>> column_files,
+    std::span<uint32_t> row_group_num_tuples) {
+  ParseTimer parse_timer;
+  auto group = std::make_unique<Group>();
+  Tokenizer tokenizer{begin, end};
+
+  for (auto row_group = first_row_group; !tokenizer.IsAtEnd(); ++row_group) {
+    uint32_t tuple_index = 0;
+    for (; tuple_index != Group::kMaxNumTuples && !tokenizer.IsAtEnd();
+         ++tuple_index) {
+      InsertLine(tokenizer, tuple_index, *group);
+    }
+    group->num_tuples = tuple_index;
+
+    for (size_t i = 0; i != Group::kNumColumns; ++i) {
+      auto size = Group::kMaxNumTuples * Group::kValueSizes[i];
+      MeasuredWriteBlock(*column_files[i],
+                         reinterpret_cast<const std::byte *>(group.get()) +
+                             Group::kColumnOffsets[i],
+                         row_group * size, size);
+    }
+    row_group_num_tuples[row_group] = tuple_index;
+  }
+  parse_timer.Stop();
+}
+
+// Stores every column in its own file <prefix>.<column name> and the number of
+// tuples of every row group in <prefix>.rowgroups
+template <typename Group>
+static void LoadColumns(const char *path_to_data_in, const char *prefix) {
+  int fd = OpenInput(path_to_data_in);
+  if (!IsRegularFile(fd)) {
+    throw std::invalid_argument{
+        "A column store can only be loaded from a regular file"};
+  }
   auto length = lseek(fd, 0, SEEK_END);
 
   void *data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
@@ -120,58 +1092,303 @@ static void LoadFile(const char *path_to_data_in,
   auto begin = static_cast<const char *>(data);
   auto end = begin + length;
 
-  storage::File output_file{path_to_data_out, storage::File::kWrite};
-
-  std::vector<std::thread> threads;
-  threads.reserve(kNumThreads);
+  std::vector<std::unique_ptr<storage::File>> column_files;
+  for (auto column_name : Group::kColumnNames) {
+    column_files.push_back(std::make_unique<storage::File>(
+        GetColumnPath(prefix, column_name).c_str(), storage::File::kWrite));
+  }
 
   auto start_time = std::chrono::steady_clock::now();
 
-  for (unsigned index = 0; index != kNumThreads; ++index) {
-    threads.emplace_back([index, begin, end, &output_file]() {
-      auto from = FindBeginBoundary<'\n'>(begin, end, kNumThreads, index);
-      auto to = FindBeginBoundary<'\n'>(begin, end, kNumThreads, index + 1);
-      LoadChunk<Page>(from, to, output_file);
-    });
-  }
+  // like LoadChunks(), every thread writes the row groups of its lines to
+  // their final positions
+  auto boundaries = SplitLines(begin, end);
+  std::vector<uint64_t> num_row_groups(options.num_threads);
+  RunOnThreads([&](unsigned index) {
+    num_row_groups[index] =
+        (CountLines(boundaries[index], boundaries[index + 1]) +
+         Group::kMaxNumTuples - 1) /
+        Group::kMaxNumTuples;
+  });
 
-  for (auto &t : threads) {
-    t.join();
+  auto first_row_groups = GetFirstIndexes(num_row_groups);
+  for (size_t i = 0; i != Group::kNumColumns; ++i) {
+    column_files[i]->Allocate(first_row_groups.back() * Group::kMaxNumTuples *
+                              Group::kValueSizes[i]);
   }
+  std::vector<uint32_t> row_group_num_tuples(first_row_groups.back());
+  RunOnThreads([&](unsigned index) {
+    LoadColumnsChunk<Group>(boundaries[index], boundaries[index + 1],
+                            first_row_groups[index], column_files,
+                            row_group_num_tuples);
+  });
+
+  // the capacity of the row groups precedes their numbers of tuples
+  row_group_num_tuples.insert(row_group_num_tuples.begin(),
+                              Group::kMaxNumTuples);
+  storage::File index_file{GetRowGroupIndexPath(prefix).c_str(),
+                           storage::File::kWrite};
+  index_file.AppendBlock(
+      reinterpret_cast<const std::byte *>(row_group_num_tuples.data()),
+      row_group_num_tuples.size() * sizeof(uint32_t));
 
   auto end_time = std::chrono::steady_clock::now();
   double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
                            end_time - start_time)
                            .count();
   std::cout << "Processed " << length / nanoseconds << " GB/s\n";
+  PrintPhaseThroughputs(length);
 
   munmap(data, length);
   close(fd);
 }
 
+template <typename Page>
+static void PrintColumnNames() {
+  std::cerr << "  " << Page::kTable.name << " ";
+  for (auto column_name : Page::kColumnNames) {
+    std::cerr << column_name
+              << (column_name == Page::kColumnNames.back() ? "\n" : ",");
+  }
+}
+
+template <typename... Pages>
+struct PageTypes {
+  // Returns a writer of the page type whose table and columns match the given
+  // ones or nullptr if there is no such page type
+  static std::unique_ptr<DataFileWriter> MakeProjectionWriter(
+      const std::string &path_to_data_out, std::string_view table_name,
+      std::span<const std::string_view> column_names, bool append) {
+    std::unique_ptr<DataFileWriter> writer;
+    (TryMake<Pages>(path_to_data_out, table_name, column_names, append,
+                    writer) ||
+     ...);
+    return writer;
+  }
+
+  static void PrintProjections() { (PrintColumnNames<Pages>(), ...); }
+
+ private:
+  template <typename Page>
+  static bool TryMake(const std::string &path_to_data_out,
+                      std::string_view table_name,
+                      std::span<const std::string_view> column_names,
+                      bool append, std::unique_ptr<DataFileWriter> &writer) {
+    if (Page::kTable.name != table_name ||
+        !std::equal(Page::kColumnNames.begin(), Page::kColumnNames.end(),
+                    column_names.begin(), column_names.end())) {
+      return false;
+    }
+    writer = std::make_unique<PageFileWriter<Page>>(path_to_data_out, append);
+    return true;
+  }
+};
+
+// The projections that can be loaded by listing their columns
+template <size_t kSize>
+using Projections =
+    PageTypes<BasicLineitemPageQ1<kSize>, BasicLineitemPageQ14<kSize>,
+              BasicPartPage<kSize>, BasicPartPageQ14<kSize>>;
+
+static std::vector<std::string_view> SplitColumnNames(std::string_view list) {
+  std::vector<std::string_view> column_names;
+  while (!list.empty()) {
+    auto separator = std::min(list.find(','), list.size());
+    column_names.push_back(list.substr(0, separator));
+    list.remove_prefix(std::min(separator + 1, list.size()));
+  }
+  return column_names;
+}
+
+// A data file that is loaded from the input
+struct Output {
+  std::string_view kind;
+  std::string path;
+  std::vector<std::string_view> column_names;
+};
+
+// Parses kind:path or <table>:path:column[,column...]
+static Output ParseOutput(std::string_view argument) {
+  auto separator = argument.find(':');
+  Output output{argument.substr(0, separator), {}, {}};
+  argument.remove_prefix(separator + 1);
+  separator = argument.find(':');
+  output.path = argument.substr(0, separator);
+  if (separator != std::string_view::npos) {
+    output.column_names = SplitColumnNames(argument.substr(separator + 1));
+  }
+  return output;
+}
+
 static void PrintUsage(const char *command) {
   std::cerr << "Usage: " << command
+            << " [--append] [--cluster-by=column] [--page-size-power=n]"
+               " [--threads=t] [--write-size-power=w]"
             << " lineitemQ1 lineitem.tbl lineitemQ1.dat |"
                " lineitemQ14 lineitem.tbl lineitemQ14.dat |"
-               " part part.tbl part.dat\n";
+               " part part.tbl part.dat |"
+               " partQ14 part.tbl partQ14.dat |"
+               " lineitemQ1Compressed lineitem.tbl lineitemQ1.dat |"
+               " lineitemColumns lineitem.tbl lineitem |"
+               " <table> <table>.tbl out.dat column[,column...]\n"
+            << "       " << command
+            << " [--append] [--page-size-power=n] [--threads=t]"
+               " [--write-size-power=w] <table>.tbl"
+               " kind:out.dat|<table>:out.dat:column[,column...]...\n"
+               "The second form loads several data files while parsing every "
+               "line only once\n"
+               "The pages are 2^n bytes large, "
+            << kMinPageSizePower << " <= n <= " << kMaxPageSizePower
+            << " (default: " << kPageSizePower << ")\n"
+            << "t > 0 threads parse the lines, each pinned to its own CPU "
+               "(default: one per CPU)\n"
+            << "The pages are written in batches of 2^w bytes (default: "
+            << std::countr_zero(options.write_size) << ")\n"
+            << "Use - as input file to read the lines from stdin\n"
+            << "--append adds the lines to existing data files, whose page "
+               "size is kept\n"
+            << "Supported column lists:\n";
+  Projections<kPageSize>::PrintProjections();
+}
+
+// Returns a writer of the data file with pages of kSize bytes or nullptr if
+// the kind is unknown. The writer appends to the data file if append is set.
+template <size_t kSize>
+static std::unique_ptr<DataFileWriter> MakeWriter(const Output &output,
+                                                  bool append) {
+  if (!output.column_names.empty()) {
+    return Projections<kSize>::MakeProjectionWriter(
+        output.path, output.kind, output.column_names, append);
+  } else if (output.kind == "lineitemQ1") {
+    return std::make_unique<PageFileWriter<BasicLineitemPageQ1<kSize>>>(
+        output.path, append);
+  } else if (output.kind == "lineitemQ1Compressed") {
+    return std::make_unique<
+        PageFileWriter<CompressedPage<BasicLineitemPageQ1<kSize>>>>(
+        output.path, append);
+  } else if (output.kind == "lineitemQ14") {
+    return std::make_unique<PageFileWriter<BasicLineitemPageQ14<kSize>>>(
+        output.path, append);
+  } else if (output.kind == "part") {
+    return std::make_unique<PageFileWriter<BasicPartPage<kSize>>>(output.path,
+                                                                  append);
+  } else if (output.kind == "partQ14") {
+    return std::make_unique<PageFileWriter<BasicPartPageQ14<kSize>>>(
+        output.path, append);
+  }
+  return nullptr;
 }
 }  // namespace
 
 int main(int argc, char *argv[]) {
-  if (argc != 4) {
+  // the tuples are optionally sorted by a column before they are written
+  constexpr std::string_view kClusterByOption = "--cluster-by=";
+  constexpr std::string_view kAppendOption = "--append";
+  constexpr std::string_view kPageSizePowerOption = "--page-size-power=";
+  constexpr std::string_view kThreadsOption = "--threads=";
+  constexpr std::string_view kWriteSizePowerOption = "--write-size-power=";
+  constexpr size_t kMaxWriteSizePower = 30;
+  std::string_view cluster_by;
+  bool append = false;
+  size_t page_size_power = kPageSizePower;
+  bool is_page_size_given = false;
+  size_t write_size_power = std::countr_zero(options.write_size);
+  int first_argument = 1;
+  for (; first_argument < argc; ++first_argument) {
+    std::string_view argument{argv[first_argument]};
+    if (argument.starts_with(kClusterByOption)) {
+      cluster_by = argument.substr(kClusterByOption.size());
+    } else if (argument == kAppendOption) {
+      append = true;
+    } else if (argument.starts_with(kPageSizePowerOption)) {
+      page_size_power = std::atoi(argv[first_argument] +
+                                  kPageSizePowerOption.size());
+      is_page_size_given = true;
+    } else if (argument.starts_with(kThreadsOption)) {
+      auto value = argument.substr(kThreadsOption.size());
+      auto [end, error] = std::from_chars(
+          value.data(), value.data() + value.size(), options.num_threads);
+      if (error != std::errc{} || end != value.data() + value.size() ||
+          options.num_threads == 0) {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (argument.starts_with(kWriteSizePowerOption)) {
+      write_size_power = std::atoi(argv[first_argument] +
+                                   kWriteSizePowerOption.size());
+    } else {
+      break;
+    }
+  }
+
+  auto num_arguments = argc - first_argument;
+  if (num_arguments < 2 || page_size_power < kMinPageSizePower ||
+      page_size_power > kMaxPageSizePower ||
+      write_size_power > kMaxWriteSizePower) {
     PrintUsage(argv[0]);
     return 1;
   }
+  options.write_size = 1ull << write_size_power;
+  if (options.num_threads == 0) {
+    options.num_threads = std::max<size_t>(GetAllowedCpus().size(), 1);
+  }
 
-  std::string_view kind{argv[1]};
-  if (kind == "lineitemQ1") {
-    LoadFile<LineitemPageQ1>(argv[2], argv[3]);
-  } else if (kind == "lineitemQ14") {
-    LoadFile<LineitemPageQ14>(argv[2], argv[3]);
-  } else if (kind == "part") {
-    LoadFile<PartPage>(argv[2], argv[3]);
+  // every output of the second form contains a colon
+  bool is_output_list =
+      std::all_of(argv + first_argument + 1, argv + argc, [](const char *arg) {
+        return std::string_view{arg}.find(':') != std::string_view::npos;
+      });
+
+  const char *path_to_data_in;
+  std::vector<Output> outputs;
+  if (is_output_list) {
+    path_to_data_in = argv[first_argument];
+    for (int i = first_argument + 1; i != argc; ++i) {
+      outputs.push_back(ParseOutput(argv[i]));
+    }
+  } else if (num_arguments == 3 || num_arguments == 4) {
+    path_to_data_in = argv[first_argument + 1];
+    auto &output = outputs.emplace_back(
+        Output{argv[first_argument], argv[first_argument + 2], {}});
+    if (num_arguments == 4) {
+      output.column_names = SplitColumnNames(argv[first_argument + 3]);
+    }
   } else {
     PrintUsage(argv[0]);
     return 1;
   }
-}
\ No newline at end of file
+
+  // a column store has no pages, its row groups have a fixed size
+  if (outputs.size() == 1 && outputs.front().kind == "lineitemColumns" &&
+      cluster_by.empty() && !append && outputs.front().column_names.empty()) {
+    if (is_page_size_given) {
+      std::cerr << "--page-size-power is not supported for lineitemColumns\n";
+      return 1;
+    }
+    LoadColumns<LineitemColumns>(path_to_data_in, outputs.front().path.c_str());
+    return 0;
+  }
+
+  // appended pages have the size of the existing ones
+  if (append && !is_page_size_given) {
+    page_size_power = Catalog::ReadFor(outputs.front().path.c_str())
+                          .GetHeader()
+                          .page_size_power;
+  }
+
+  std::vector<std::unique_ptr<DataFileWriter>> writers;
+  DispatchPageSize(page_size_power, [&](auto page_size) {
+    for (const auto &output : outputs) {
+      auto writer = MakeWriter<decltype(page_size)::value>(output, append);
+      if (!writer) {
+        return;
+      }
+      writers.push_back(std::move(writer));
+    }
+  });
+  if (writers.size() != outputs.size()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  LoadFiles(path_to_data_in, writers, cluster_by);
+}
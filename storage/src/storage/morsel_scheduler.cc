@@ -0,0 +1,109 @@
+#include "storage/morsel_scheduler.h"
+
+#include <algorithm>
+
+#include "storage/numa.h"
+
+namespace storage {
+
+MorselScheduler::MorselScheduler(uint64_t num_items, unsigned num_threads,
+                                 uint64_t morsel_cost)
+    : num_items_(num_items), morsel_cost_(std::max<uint64_t>(morsel_cost, 1)) {
+  Partition(num_threads);
+}
+
+MorselScheduler::MorselScheduler(std::span<const uint64_t> costs,
+                                 unsigned num_threads, uint64_t morsel_cost)
+    : cost_prefix_(costs.size() + 1),
+      num_items_(costs.size()),
+      morsel_cost_(std::max<uint64_t>(morsel_cost, 1)) {
+  for (uint64_t i = 0; i != costs.size(); ++i) {
+    cost_prefix_[i + 1] = cost_prefix_[i] + costs[i];
+  }
+  Partition(num_threads);
+}
+
+void MorselScheduler::Partition(unsigned num_threads) {
+  ranges_ = std::make_unique<Range[]>(num_threads);
+  auto total_cost = GetCost(num_items_);
+  for (unsigned i = 0; i != num_threads; ++i) {
+    ranges_[i].begin = FindItem(0, num_items_, total_cost * i / num_threads);
+    ranges_[i].end =
+        FindItem(0, num_items_, total_cost * (i + 1) / num_threads);
+  }
+
+  auto num_nodes = GetNumaNodes().size();
+  victims_.resize(num_threads);
+  for (unsigned i = 0; i != num_threads; ++i) {
+    for (bool same_node : {true, false}) {
+      for (unsigned offset = 1; offset != num_threads; ++offset) {
+        auto victim = (i + offset) % num_threads;
+        if ((victim % num_nodes == i % num_nodes) == same_node) {
+          victims_[i].push_back(victim);
+        }
+      }
+    }
+  }
+}
+
+uint64_t MorselScheduler::FindItem(uint64_t begin, uint64_t end,
+                                   uint64_t cost) const noexcept {
+  if (cost_prefix_.empty()) {
+    return std::clamp(cost, begin, end);
+  }
+  return std::lower_bound(cost_prefix_.begin() + begin,
+                          cost_prefix_.begin() + end, cost) -
+         cost_prefix_.begin();
+}
+
+std::optional<Morsel> MorselScheduler::Next(unsigned thread_index) {
+  auto &range = ranges_[thread_index];
+  do {
+    std::lock_guard lock{range.mutex};
+    if (range.begin != range.end) {
+      // GetCost(range.begin) < the cost searched for, so the morsel is never
+      // empty
+      Morsel morsel{range.begin,
+                    FindItem(range.begin, range.end,
+                             GetCost(range.begin) + morsel_cost_)};
+      range.begin = morsel.end;
+      return morsel;
+    }
+  } while (Steal(thread_index));
+  return std::nullopt;
+}
+
+bool MorselScheduler::Steal(unsigned thread_index) {
+  for (auto victim : victims_[thread_index]) {
+    Morsel stolen;
+    {
+      auto &range = ranges_[victim];
+      std::lock_guard lock{range.mutex};
+      if (range.begin == range.end) {
+        continue;
+      }
+      auto middle = FindItem(range.begin, range.end,
+                             (GetCost(range.begin) + GetCost(range.end)) / 2);
+      // take at least the last item
+      stolen = {std::min(middle, range.end - 1), range.end};
+      range.end = stolen.begin;
+    }
+    auto &range = ranges_[thread_index];
+    std::lock_guard lock{range.mutex};
+    range.begin = stolen.begin;
+    range.end = stolen.end;
+    return true;
+  }
+  return false;
+}
+
+std::vector<uint64_t> GetSwipCosts(std::span<const Swip> swips) {
+  std::vector<uint64_t> costs;
+  costs.reserve(swips.size());
+  for (auto swip : swips) {
+    costs.push_back(swip.IsPageIndex() ? kPageReadCost : 1);
+  }
+  return costs;
+}
+
+}  // namespace storage
@@ -0,0 +1,81 @@
+#ifndef STORAGE_MORSEL_SCHEDULER_H_
+#define STORAGE_MORSEL_SCHEDULER_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "storage/swip.h"
+
+namespace storage {
+
+// The items [begin, end) that a thread processes at once
+struct Morsel {
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Distributes the items [0, num_items) among threads in morsels. Every thread
+// starts with a contiguous range of items of equal total cost and takes its
+// morsels from the front of it. A thread whose range is exhausted steals the
+// back half of the range of another thread, trying the threads on its own
+// NUMA node first. Thread i is assumed to run on GetNumaNodes()[i % n] like
+// the threads of the queries. A morsel spans about morsel_cost, so it holds
+// fewer expensive items (e.g. pages that have to be read) than cheap ones
+// (e.g. cached pages).
+class MorselScheduler {
+ public:
+  // Every item costs 1
+  MorselScheduler(uint64_t num_items, unsigned num_threads,
+                  uint64_t morsel_cost);
+
+  // Item i costs costs[i], which must be positive
+  MorselScheduler(std::span<const uint64_t> costs, unsigned num_threads,
+                  uint64_t morsel_cost);
+
+  // Returns the next morsel of the thread or std::nullopt once all items have
+  // been handed out
+  std::optional<Morsel> Next(unsigned thread_index);
+
+ private:
+  struct alignas(64) Range {
+    std::mutex mutex;
+    uint64_t begin{0};
+    uint64_t end{0};
+  };
+
+  void Partition(unsigned num_threads);
+
+  // Returns the total cost of the items [0, i)
+  uint64_t GetCost(uint64_t i) const noexcept {
+    return cost_prefix_.empty() ? i : cost_prefix_[i];
+  }
+
+  // Returns the first i in [begin, end] with GetCost(i) >= cost or end
+  uint64_t FindItem(uint64_t begin, uint64_t end, uint64_t cost) const noexcept;
+
+  // Moves the back half of the range of another thread to the range of the
+  // thread. Returns false if all ranges are empty.
+  bool Steal(unsigned thread_index);
+
+  std::vector<uint64_t> cost_prefix_;
+  const uint64_t num_items_;
+  const uint64_t morsel_cost_;
+  std::unique_ptr<Range[]> ranges_;
+  // the other threads in the order in which a thread steals from them
+  std::vector<std::vector<unsigned>> victims_;
+};
+
+// The cost of a page that has to be read relative to a cached page
+constexpr uint64_t kPageReadCost = 4;
+
+// Returns the costs of the pages that swips refer to for a MorselScheduler: 1
+// for a cached page and kPageReadCost for a page that has to be read
+std::vector<uint64_t> GetSwipCosts(std::span<const Swip> swips);
+
+}  // namespace storage
+
+#endif  // STORAGE_MORSEL_SCHEDULER_H_
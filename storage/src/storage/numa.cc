@@ -0,0 +1,108 @@
+#include "storage/numa.h"
+
+#include <numa.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+namespace {
+[[noreturn]] static void ThrowErrno() {
+  throw std::system_error{errno, std::system_category()};
+}
+
+static uint64_t RoundUp(uint64_t value, uint64_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+static bool IsNumaAvailable() {
+  static const bool is_available = numa_available() >= 0;
+  return is_available;
+}
+
+static std::vector<storage::NumaNode> DetermineNumaNodes() {
+  if (!IsNumaAvailable()) {
+    return {0};
+  }
+
+  std::vector<storage::NumaNode> nodes;
+  bitmask *memory_nodes = numa_get_mems_allowed();
+  bitmask *run_nodes = numa_get_run_node_mask();
+  for (int node = 0; node <= numa_max_node(); ++node) {
+    if (numa_bitmask_isbitset(memory_nodes, node) &&
+        numa_bitmask_isbitset(run_nodes, node)) {
+      nodes.push_back(node);
+    }
+  }
+  numa_bitmask_free(memory_nodes);
+  numa_bitmask_free(run_nodes);
+
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+}  // namespace
+
+namespace storage {
+
+const std::vector<NumaNode> &GetNumaNodes() {
+  static const std::vector<NumaNode> nodes = DetermineNumaNodes();
+  return nodes;
+}
+
+NumaNode GetCurrentNumaNode() {
+  if (!IsNumaAvailable()) {
+    return 0;
+  }
+  int cpu = sched_getcpu();
+  if (cpu < 0) {
+    return 0;
+  }
+  int node = numa_node_of_cpu(cpu);
+  return node < 0 ? 0 : node;
+}
+
+void BindCurrentThreadToNumaNode(NumaNode node) {
+  if (IsNumaAvailable() && numa_run_on_node(node) != 0) {
+    ThrowErrno();
+  }
+}
+
+std::byte *MapOnNumaNode(size_t size, size_t alignment, NumaNode node) {
+  size_t system_page_size = sysconf(_SC_PAGESIZE);
+  alignment = std::max(alignment, system_page_size);
+  size = RoundUp(size, system_page_size);
+
+  // over-allocate so that we can align the beginning of the mapping and return
+  // the superfluous head and tail to the operating system afterwards
+  void *mapping =
+      mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    ThrowErrno();
+  }
+  auto *begin = static_cast<std::byte *>(mapping);
+  auto *data = reinterpret_cast<std::byte *>(
+      RoundUp(reinterpret_cast<uintptr_t>(mapping), alignment));
+  if (data != begin) {
+    munmap(begin, data - begin);
+  }
+  if (auto tail_size = alignment - (data - begin); tail_size > 0) {
+    munmap(data + size, tail_size);
+  }
+
+  if (IsNumaAvailable()) {
+    numa_tonode_memory(data, size, node);
+  }
+  return data;
+}
+
+void UnmapOnNumaNode(std::byte *data, size_t size) {
+  munmap(data, RoundUp(size, sysconf(_SC_PAGESIZE)));
+}
+
+}  // namespace storage
@@ -0,0 +1,136 @@
+#ifndef STORAGE_NUMA_H_
+#define STORAGE_NUMA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace storage {
+
+using NumaNode = unsigned;
+
+// Returns the NUMA nodes on which the process may both run and allocate
+// memory, e.g. only node 0 when started with `numactl --membind=0
+// --cpubind=0`. Returns {0} if the system has no NUMA support.
+const std::vector<NumaNode> &GetNumaNodes();
+
+// Returns the NUMA node of the CPU the calling thread is currently running on
+NumaNode GetCurrentNumaNode();
+
+// Restricts the calling thread to the CPUs of the given node
+void BindCurrentThreadToNumaNode(NumaNode node);
+
+// Maps size bytes (aligned to alignment) whose physical pages are placed on the
+// given node as soon as they are touched. The mapping does not reserve swap
+// space, so it is fine to map far more than will actually be used.
+std::byte *MapOnNumaNode(size_t size, size_t alignment, NumaNode node);
+
+// Unmaps memory previously returned by MapOnNumaNode()
+void UnmapOnNumaNode(std::byte *data, size_t size);
+
+struct NumaStatistics {
+  uint64_t num_local_hits{0};
+  uint64_t num_remote_hits{0};
+  uint64_t num_misses{0};
+
+  NumaStatistics &operator+=(const NumaStatistics &other) noexcept {
+    num_local_hits += other.num_local_hits;
+    num_remote_hits += other.num_remote_hits;
+    num_misses += other.num_misses;
+    return *this;
+  }
+};
+
+// Holds up to capacity_per_node page frames on every node returned by
+// GetNumaNodes(). Frames of one node must only be allocated by one thread at a
+// time.
+template <typename Page>
+class NumaFramePool {
+ public:
+  explicit NumaFramePool(uint64_t capacity_per_node)
+      : capacity_per_node_(capacity_per_node) {
+    for (auto node : GetNumaNodes()) {
+      partitions_.push_back(
+          {node,
+           reinterpret_cast<Page *>(MapOnNumaNode(GetPartitionSize(),
+                                                  alignof(Page), node)),
+           0});
+    }
+  }
+
+  NumaFramePool(const NumaFramePool &) = delete;
+  NumaFramePool &operator=(const NumaFramePool &) = delete;
+
+  NumaFramePool(NumaFramePool &&other) noexcept
+      : partitions_(std::move(other.partitions_)),
+        capacity_per_node_(other.capacity_per_node_) {
+    other.partitions_.clear();
+  }
+
+  ~NumaFramePool() {
+    for (const auto &partition : partitions_) {
+      UnmapOnNumaNode(reinterpret_cast<std::byte *>(partition.frames),
+                      GetPartitionSize());
+    }
+  }
+
+  // Returns a frame located on the given node or nullptr if there is none left
+  Page *Allocate(NumaNode node) noexcept {
+    auto &partition = GetPartition(node);
+    if (partition.num_used_frames == capacity_per_node_) {
+      return nullptr;
+    }
+    return &partition.frames[partition.num_used_frames++];
+  }
+
+  // Returns the number of frames that Allocate() can still return for the node
+  uint64_t GetNumFreeFrames(NumaNode node) const noexcept {
+    for (const auto &partition : partitions_) {
+      if (partition.node == node) {
+        return capacity_per_node_ - partition.num_used_frames;
+      }
+    }
+    return capacity_per_node_ - partitions_.front().num_used_frames;
+  }
+
+  // Returns the node of a frame previously returned by Allocate()
+  NumaNode GetNode(const void *frame) const noexcept {
+    auto *page = static_cast<const Page *>(frame);
+    for (const auto &partition : partitions_) {
+      if (partition.frames <= page &&
+          page < partition.frames + capacity_per_node_) {
+        return partition.node;
+      }
+    }
+    return partitions_.front().node;
+  }
+
+ private:
+  struct Partition {
+    NumaNode node;
+    Page *frames;
+    uint64_t num_used_frames;
+  };
+
+  size_t GetPartitionSize() const noexcept {
+    return std::max<uint64_t>(capacity_per_node_, 1) * sizeof(Page);
+  }
+
+  Partition &GetPartition(NumaNode node) noexcept {
+    for (auto &partition : partitions_) {
+      if (partition.node == node) {
+        return partition;
+      }
+    }
+    return partitions_.front();
+  }
+
+  std::vector<Partition> partitions_;
+  const uint64_t capacity_per_node_;
+};
+
+}  // namespace storage
+
+#endif  // STORAGE_NUMA_H_
@@ -0,0 +1,234 @@
+#ifndef STORAGE_PAX_PAGE_H_
+#define STORAGE_PAX_PAGE_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <tuple>
+
+namespace storage {
+
+constexpr size_t kCacheLineSize = 64;
+
+// A string literal that can be used as a template argument
+template <size_t kLength>
+struct ColumnName {
+  constexpr ColumnName(const char (&name)[kLength]) noexcept {
+    std::copy_n(name, kLength, value);
+  }
+
+  constexpr std::string_view View() const noexcept {
+    return {value, kLength - 1};
+  }
+
+  char value[kLength];
+};
+
+template <ColumnName kName, typename T>
+struct Column {
+  using Type = T;
+
+  static constexpr std::string_view GetName() noexcept { return kName.View(); }
+};
+
+namespace detail {
+constexpr size_t RoundUp(size_t value, size_t multiple) noexcept {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Every column starts at a multiple of alignment
+template <size_t kNumColumns>
+constexpr std::array<size_t, kNumColumns> ComputePaxColumnOffsets(
+    const std::array<size_t, kNumColumns> &value_sizes, uint64_t num_tuples,
+    size_t alignment = kCacheLineSize) noexcept {
+  std::array<size_t, kNumColumns> offsets{};
+  size_t offset = sizeof(uint32_t);  // the number of tuples
+  for (size_t i = 0; i != kNumColumns; ++i) {
+    offsets[i] = RoundUp(offset, alignment);
+    offset = offsets[i] + num_tuples * value_sizes[i];
+  }
+  return offsets;
+}
+
+template <size_t kNumColumns>
+constexpr uint64_t ComputePaxMaxNumTuples(
+    size_t page_size, const std::array<size_t, kNumColumns> &value_sizes) {
+  auto used_size = [&value_sizes](uint64_t num_tuples) {
+    return ComputePaxColumnOffsets(value_sizes, num_tuples).back() +
+           num_tuples * value_sizes.back();
+  };
+
+  // start with an upper bound that ignores padding and decrease it until the
+  // padded columns fit
+  size_t tuple_size = 0;
+  for (auto value_size : value_sizes) {
+    tuple_size += value_size;
+  }
+  uint64_t num_tuples = (page_size - sizeof(uint32_t)) / tuple_size;
+  while (num_tuples > 0 && used_size(num_tuples) > page_size) {
+    --num_tuples;
+  }
+  return num_tuples;
+}
+
+// Hashes the format of a page and the names and sizes of its columns with
+// FNV-1a. Pages of different sizes with the same columns get the same id.
+template <size_t kNumColumns>
+constexpr uint64_t ComputeLayoutId(
+    std::string_view format,
+    const std::array<std::string_view, kNumColumns> &column_names,
+    const std::array<size_t, kNumColumns> &value_sizes) noexcept {
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](uint8_t byte) { hash = (hash ^ byte) * 1099511628211ull; };
+  for (char c : format) {
+    add(c);
+  }
+  for (size_t i = 0; i != kNumColumns; ++i) {
+    add('|');
+    for (char c : column_names[i]) {
+      add(c);
+    }
+    for (size_t byte = 0; byte != sizeof(size_t); ++byte) {
+      add(value_sizes[i] >> (8 * byte));
+    }
+  }
+  return hash;
+}
+}  // namespace detail
+
+// A page of kSize bytes in the PAX format: the page starts with the number of
+// tuples, followed by one array of kMaxNumTuples values per column. Every array
+// starts at a cache line boundary. kMaxNumTuples is the largest number of
+// tuples for which all arrays fit into the page.
+template <size_t kSize, typename... Columns>
+struct alignas(kSize) PaxPage {
+  static constexpr size_t kNumColumns = sizeof...(Columns);
+
+  template <size_t kIndex>
+  using ColumnType =
+      typename std::tuple_element_t<kIndex, std::tuple<Columns...>>::Type;
+
+  // A page with the same columns but a different size
+  template <size_t kOtherSize>
+  using Resized = PaxPage<kOtherSize, Columns...>;
+
+  static constexpr std::array<std::string_view, kNumColumns> kColumnNames = {
+      Columns::GetName()...};
+
+  static constexpr std::array<size_t, kNumColumns> kValueSizes = {
+      sizeof(typename Columns::Type)...};
+
+  static constexpr uint64_t kMaxNumTuples =
+      detail::ComputePaxMaxNumTuples(kSize, kValueSizes);
+  static_assert(kMaxNumTuples > 0, "A single tuple does not fit into a page");
+
+  // Stored in the header of data files to recognize the page type
+  static constexpr uint64_t kLayoutId =
+      detail::ComputeLayoutId("pax", kColumnNames, kValueSizes);
+
+  // The offsets of the columns relative to the beginning of the page
+  static constexpr std::array<size_t, kNumColumns> kColumnOffsets =
+      detail::ComputePaxColumnOffsets(kValueSizes, kMaxNumTuples);
+
+  // Returns the index of the column with the given name or kNumColumns if
+  // there is no such column
+  static constexpr size_t IndexOf(std::string_view name) noexcept {
+    return std::find(kColumnNames.begin(), kColumnNames.end(), name) -
+           kColumnNames.begin();
+  }
+
+  template <size_t kIndex>
+  std::span<ColumnType<kIndex>, kMaxNumTuples> Get() noexcept {
+    return std::span<ColumnType<kIndex>, kMaxNumTuples>{
+        reinterpret_cast<ColumnType<kIndex> *>(
+            reinterpret_cast<std::byte *>(this) + kColumnOffsets[kIndex]),
+        kMaxNumTuples};
+  }
+
+  template <size_t kIndex>
+  std::span<const ColumnType<kIndex>, kMaxNumTuples> Get() const noexcept {
+    return std::span<const ColumnType<kIndex>, kMaxNumTuples>{
+        reinterpret_cast<const ColumnType<kIndex> *>(
+            reinterpret_cast<const std::byte *>(this) + kColumnOffsets[kIndex]),
+        kMaxNumTuples};
+  }
+
+  uint32_t num_tuples;
+
+ private:
+  std::array<std::byte, kSize - sizeof(uint32_t)> data_;
+};
+
+// A byte range of a page
+struct PageBlock {
+  size_t offset;
+  size_t size;
+};
+
+// At most kMaxNumBlocks byte ranges of a page, sorted by their offsets
+template <size_t kMaxNumBlocks>
+struct PageBlocks {
+  std::array<PageBlock, kMaxNumBlocks> blocks{};
+  size_t num_blocks{0};
+
+  constexpr std::span<const PageBlock> Get() const noexcept {
+    return {blocks.data(), num_blocks};
+  }
+
+  constexpr size_t GetTotalSize() const noexcept {
+    size_t size = 0;
+    for (size_t i = 0; i != num_blocks; ++i) {
+      size += blocks[i].size;
+    }
+    return size;
+  }
+};
+
+// Returns the byte ranges of a PAX page that contain the number of tuples and
+// the values of the given columns. The ranges are widened to multiples of
+// alignment and merged if they overlap or touch.
+template <typename Page, size_t kNumIndexes>
+constexpr PageBlocks<kNumIndexes + 1> GetColumnBlocks(
+    const std::array<size_t, kNumIndexes> &column_indexes,
+    size_t alignment) noexcept {
+  auto round_down = [alignment](size_t value) {
+    return value / alignment * alignment;
+  };
+
+  std::array<PageBlock, kNumIndexes + 1> ranges{};
+  ranges[0] = {0, detail::RoundUp(sizeof(uint32_t), alignment)};
+  for (size_t i = 0; i != kNumIndexes; ++i) {
+    auto offset = Page::kColumnOffsets[column_indexes[i]];
+    auto size = Page::kMaxNumTuples * Page::kValueSizes[column_indexes[i]];
+    auto begin = round_down(offset);
+    auto end =
+        std::min(detail::RoundUp(offset + size, alignment), sizeof(Page));
+    ranges[i + 1] = {begin, end - begin};
+  }
+  std::sort(ranges.begin(), ranges.end(),
+            [](const PageBlock &lhs, const PageBlock &rhs) {
+              return lhs.offset < rhs.offset;
+            });
+
+  PageBlocks<kNumIndexes + 1> result;
+  for (const auto &range : ranges) {
+    if (result.num_blocks != 0) {
+      auto &last = result.blocks[result.num_blocks - 1];
+      if (range.offset <= last.offset + last.size) {
+        last.size =
+            std::max(last.offset + last.size, range.offset + range.size) -
+            last.offset;
+        continue;
+      }
+    }
+    result.blocks[result.num_blocks++] = range;
+  }
+  return result;
+}
+
+}  // namespace storage
+
+#endif  // STORAGE_PAX_PAGE_H_
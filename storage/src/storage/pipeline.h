@@ -0,0 +1,293 @@
+#ifndef STORAGE_PIPELINE_H_
+#define STORAGE_PIPELINE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "cppcoro/sync_wait.hpp"
+#include "cppcoro/task.hpp"
+#include "cppcoro/when_all_ready.hpp"
+#include "storage/io_uring.h"
+#include "storage/morsel_scheduler.h"
+#include "storage/swip.h"
+#include "storage/worker_pool.h"
+
+namespace storage {
+
+// Push-based operators that are composed into pipelines at compile time. A
+// scan pushes every tuple of its pages into the first operator of a pipeline,
+// which pushes the tuples it produces into the next one. An operator consumes
+// the i-th tuple of a page with
+//
+//   template <typename Tuples, typename... Payloads>
+//   void Consume(const Tuples &tuples, uint32_t i, const Payloads &...);
+//
+// where a probe appends the value of the matching build tuple to the payloads.
+// Every thread pushes into its own pipeline, so the operators need no
+// synchronization. The sinks write into thread-local state that is combined
+// after the scan.
+//
+// A pipeline that processes whole pages at once, e.g. with a vectorized
+// kernel, instead provides
+//
+//   void ConsumePage(const Page &page, Swip swip, uint64_t swip_index);
+//
+// which the scan calls with the swip of the page and its index in the swips of
+// the scan.
+
+template <typename Pipeline, typename Page>
+concept PageConsumer = requires(Pipeline &pipeline, const Page &page,
+                                Swip swip, uint64_t swip_index) {
+  pipeline.ConsumePage(page, swip, swip_index);
+};
+
+// Passes on the tuples that satisfy predicate(tuples, i)
+template <typename Predicate, typename Next>
+class Filter {
+ public:
+  Filter(Predicate predicate, Next next)
+      : predicate_(std::move(predicate)), next_(std::move(next)) {}
+
+  template <typename Tuples, typename... Payloads>
+  void Consume(const Tuples &tuples, uint32_t i, const Payloads &...payloads) {
+    if (predicate_(tuples, i)) {
+      next_.Consume(tuples, i, payloads...);
+    }
+  }
+
+ private:
+  Predicate predicate_;
+  Next next_;
+};
+
+// Folds the tuples into the state of a thread with
+// update(state, tuples, i, payloads...)
+template <typename State, typename Update>
+class Aggregate {
+ public:
+  Aggregate(State &state, Update update)
+      : state_(state), update_(std::move(update)) {}
+
+  template <typename Tuples, typename... Payloads>
+  void Consume(const Tuples &tuples, uint32_t i, const Payloads &...payloads) {
+    update_(state_, tuples, i, payloads...);
+  }
+
+ private:
+  State &state_;
+  Update update_;
+};
+
+// A hash table for joins that is built in two phases like the hash tables of
+// query 14: every thread collects its entries, then the entries are linked
+// into the buckets. Key needs hash() and operator==.
+template <typename Key, typename Value>
+class JoinHashTable {
+ public:
+  explicit JoinHashTable(unsigned num_threads)
+      : thread_local_entries_(num_threads) {}
+
+  void Insert(unsigned thread_index, Key key, Value value) {
+    thread_local_entries_[thread_index].push_back(Entry{nullptr, key, value});
+  }
+
+  // Links the entries into the buckets, the entries of every thread by the
+  // worker with its index. Must be called once after all inserts.
+  void Finish(WorkerPool &workers) {
+    uint64_t total_size = 0;
+    for (const auto &entries : thread_local_entries_) {
+      total_size += entries.size();
+    }
+    buckets_.resize(std::bit_ceil(std::max<uint64_t>(total_size, 1)));
+    mask_ = buckets_.size() - 1;
+
+    workers.Run([this](Worker &worker) {
+      for (auto &entry : thread_local_entries_[worker.GetIndex()]) {
+        std::atomic_ref head{buckets_[entry.key.hash() & mask_]};
+        entry.next = head.load();
+        while (!head.compare_exchange_weak(entry.next, &entry)) {
+        }
+      }
+    });
+  }
+
+  // Calls f with the value of every entry whose key equals key
+  template <typename F>
+  void ForEachMatch(Key key, F &&f) const {
+    for (const Entry *entry = buckets_[key.hash() & mask_]; entry != nullptr;
+         entry = entry->next) {
+      if (entry->key == key) {
+        f(entry->value);
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    Entry *next;
+    Key key;
+    Value value;
+  };
+
+  std::vector<std::vector<Entry>> thread_local_entries_;
+  std::vector<Entry *> buckets_;
+  uint64_t mask_{0};
+};
+
+// Inserts key_of(tuples, i) with value_of(tuples, i) into a JoinHashTable
+template <typename Table, typename KeyOf, typename ValueOf>
+class HashBuild {
+ public:
+  HashBuild(Table &table, unsigned thread_index, KeyOf key_of,
+            ValueOf value_of)
+      : table_(table),
+        thread_index_(thread_index),
+        key_of_(std::move(key_of)),
+        value_of_(std::move(value_of)) {}
+
+  template <typename Tuples, typename... Payloads>
+  void Consume(const Tuples &tuples, uint32_t i, const Payloads &...) {
+    table_.Insert(thread_index_, key_of_(tuples, i), value_of_(tuples, i));
+  }
+
+ private:
+  Table &table_;
+  const unsigned thread_index_;
+  KeyOf key_of_;
+  ValueOf value_of_;
+};
+
+// Passes on the tuple once for every entry of a JoinHashTable whose key equals
+// key_of(tuples, i) and appends the value of the entry to the payloads
+template <typename Table, typename KeyOf, typename Next>
+class HashProbe {
+ public:
+  HashProbe(const Table &table, KeyOf key_of, Next next)
+      : table_(table), key_of_(std::move(key_of)), next_(std::move(next)) {}
+
+  template <typename Tuples, typename... Payloads>
+  void Consume(const Tuples &tuples, uint32_t i, const Payloads &...payloads) {
+    table_.ForEachMatch(key_of_(tuples, i), [&](const auto &value) {
+      next_.Consume(tuples, i, payloads..., value);
+    });
+  }
+
+ private:
+  const Table &table_;
+  KeyOf key_of_;
+  Next next_;
+};
+
+namespace detail {
+
+// Pushes the tuples of the pages that swips refer to into pipeline. Pages that
+// are not cached are read into buffer, synchronously if ring is nullptr.
+// swips[0] has the index first_swip_index in the swips of the scan.
+template <typename Page, typename DataFile, typename Pipeline>
+cppcoro::task<void> ScanPages(const DataFile &data_file,
+                              std::span<const Swip> swips,
+                              uint64_t first_swip_index, Page &buffer,
+                              Pipeline &pipeline, IOUring *ring,
+                              Countdown &countdown) {
+  // with asynchronous I/O, the pages that have to be read are processed first,
+  // then the cached ones
+  for (bool is_page_index : {true, false}) {
+    for (uint64_t i = 0; i != swips.size(); ++i) {
+      auto swip = swips[i];
+      if (ring != nullptr && swip.IsPageIndex() != is_page_index) {
+        continue;
+      }
+      const Page *page;
+      if (swip.IsPageIndex()) {
+        if (ring == nullptr) {
+          data_file.ReadPage(swip.GetPageIndex(), &buffer);
+        } else {
+          co_await data_file.AsyncReadPage(*ring, swip.GetPageIndex(),
+                                           &buffer);
+        }
+        page = &buffer;
+      } else {
+        page = swip.GetPointer<const Page>();
+      }
+      if constexpr (PageConsumer<Pipeline, Page>) {
+        pipeline.ConsumePage(*page, swip, first_swip_index + i);
+      } else {
+        for (uint32_t j = 0, num_tuples = page->num_tuples; j != num_tuples;
+             ++j) {
+          pipeline.Consume(*page, j);
+        }
+      }
+    }
+    // a synchronous scan processes all pages in their order in one pass
+    if (ring == nullptr) {
+      break;
+    }
+  }
+  countdown.Decrement();
+}
+
+template <typename Page, typename DataFile, typename Pipeline>
+void ScanOnWorker(const DataFile &data_file, std::span<const Swip> swips,
+                  Pipeline &pipeline, MorselScheduler &scheduler,
+                  Worker &worker, uint32_t num_ring_entries) {
+  bool is_synchronous = num_ring_entries == 0;
+  uint32_t num_scans = is_synchronous ? 1 : num_ring_entries;
+  IOUring *ring = is_synchronous ? nullptr : worker.GetRing();
+  auto *buffers = worker.GetPages<Page>(num_scans);
+
+  std::vector<cppcoro::task<void>> tasks;
+  tasks.reserve(num_scans + 1);
+  while (auto morsel = scheduler.Next(worker.GetIndex())) {
+    auto [begin, end] = *morsel;
+    auto num_pages_per_scan = (end - begin + num_scans - 1) / num_scans;
+
+    Countdown countdown(num_scans);
+    for (uint32_t i = 0; i != num_scans; ++i) {
+      auto local_begin = std::min(begin + i * num_pages_per_scan, end);
+      auto local_end = std::min(local_begin + num_pages_per_scan, end);
+      tasks.emplace_back(ScanPages(
+          data_file, swips.subspan(local_begin, local_end - local_begin),
+          local_begin, buffers[i], pipeline, ring, countdown));
+    }
+    if (ring != nullptr) {
+      tasks.emplace_back(DrainRing(*ring, countdown));
+    }
+    cppcoro::sync_wait(cppcoro::when_all_ready(std::move(tasks)));
+    tasks.clear();
+  }
+}
+
+}  // namespace detail
+
+// Pushes the tuples of the pages that swips refer to into the pipelines, the
+// worker with index i into pipelines[i]. The workers take morsels of about
+// num_tuples_per_morsel tuples (more if pages are cached) from a
+// MorselScheduler. With num_ring_entries == 0 the pages that are not cached
+// are read synchronously. Otherwise every worker runs num_ring_entries scans at
+// once that co_await their reads on its io_uring, which needs at least
+// num_ring_entries entries. Both use the same scan coroutine, so a pipeline
+// gets asynchronous I/O without any code of its own.
+template <typename Page, typename DataFile, typename Pipeline>
+void Scan(WorkerPool &workers, const DataFile &data_file,
+          std::span<const Swip> swips, std::vector<Pipeline> &pipelines,
+          uint32_t num_ring_entries, uint64_t num_tuples_per_morsel) {
+  uint64_t num_pages_per_morsel =
+      (num_tuples_per_morsel + Page::kMaxNumTuples - 1) / Page::kMaxNumTuples;
+  // every scan of a worker processes about one morsel at a time
+  num_pages_per_morsel *= std::max<uint32_t>(num_ring_entries, 1);
+  MorselScheduler scheduler{GetSwipCosts(swips), workers.GetNumThreads(),
+                            num_pages_per_morsel * kPageReadCost};
+  workers.Run([&](Worker &worker) {
+    detail::ScanOnWorker<Page>(data_file, swips, pipelines[worker.GetIndex()],
+                               scheduler, worker, num_ring_entries);
+  });
+}
+
+}  // namespace storage
+
+#endif  // STORAGE_PIPELINE_H_
@@ -1,69 +1,190 @@
 #ifndef STORAGE_SCHEMA_H_
 #define STORAGE_SCHEMA_H_
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <string_view>
 
+#include "storage/column_store.h"
 #include "storage/file.h"
+#include "storage/pax_page.h"
 #include "storage/types.h"
 
 namespace storage {
 
-static_assert(kPageSizePower >= 12 && kPageSizePower <= 22);
-
-constexpr std::array<uint64_t, 11> kLineitemPageQ1MaxNumTuples = {
-    107, 215, 430, 862, 1724, 3449, 6898, 13796, 27593, 55188, 110376};
-
-struct alignas(kPageSize) LineitemPageQ1 {
-  static constexpr uint64_t kMaxNumTuples =
-      kLineitemPageQ1MaxNumTuples[kPageSizePower - 12];
-  uint32_t num_tuples;
-  std::array<Numeric<12, 2>, kMaxNumTuples> l_quantity;
-  std::array<Numeric<12, 2>, kMaxNumTuples> l_extendedprice;
-  std::array<Numeric<12, 2>, kMaxNumTuples> l_discount;
-  std::array<Numeric<12, 2>, kMaxNumTuples> l_tax;
-  std::array<Char, kMaxNumTuples> l_returnflag;
-  std::array<Char, kMaxNumTuples> l_linestatus;
-  std::array<Date, kMaxNumTuples> l_shipdate;
+// The columns of a TPC-H table in the order in which they appear in the .tbl
+// files generated by dbgen
+template <size_t kNumColumns>
+struct Table {
+  std::string_view name;
+  std::array<std::string_view, kNumColumns> column_names;
+
+  // Returns the position of the column with the given name or kNumColumns if
+  // there is no such column
+  constexpr size_t IndexOf(std::string_view column_name) const noexcept {
+    return std::find(column_names.begin(), column_names.end(), column_name) -
+           column_names.begin();
+  }
 };
 
+constexpr Table<16> kLineitemTable = {
+    "lineitem",
+    {"l_orderkey", "l_partkey", "l_suppkey", "l_linenumber", "l_quantity",
+     "l_extendedprice", "l_discount", "l_tax", "l_returnflag", "l_linestatus",
+     "l_shipdate", "l_commitdate", "l_receiptdate", "l_shipinstruct",
+     "l_shipmode", "l_comment"}};
+
+constexpr Table<9> kPartTable = {
+    "part",
+    {"p_partkey", "p_name", "p_mfgr", "p_brand", "p_type", "p_size",
+     "p_container", "p_retailprice", "p_comment"}};
+
+// The page layouts are templates so that the same columns can also be used for
+// buffers of a different size
+
+template <size_t kSize>
+struct BasicLineitemPageQ1
+    : PaxPage<kSize, Column<"l_quantity", Numeric<12, 2>>,
+              Column<"l_extendedprice", Numeric<12, 2>>,
+              Column<"l_discount", Numeric<12, 2>>,
+              Column<"l_tax", Numeric<12, 2>>, Column<"l_returnflag", Char>,
+              Column<"l_linestatus", Char>, Column<"l_shipdate", Date>> {
+  static constexpr const auto &kTable = kLineitemTable;
+
+  auto l_quantity() noexcept { return this->template Get<0>(); }
+  auto l_quantity() const noexcept { return this->template Get<0>(); }
+  auto l_extendedprice() noexcept { return this->template Get<1>(); }
+  auto l_extendedprice() const noexcept { return this->template Get<1>(); }
+  auto l_discount() noexcept { return this->template Get<2>(); }
+  auto l_discount() const noexcept { return this->template Get<2>(); }
+  auto l_tax() noexcept { return this->template Get<3>(); }
+  auto l_tax() const noexcept { return this->template Get<3>(); }
+  auto l_returnflag() noexcept { return this->template Get<4>(); }
+  auto l_returnflag() const noexcept { return this->template Get<4>(); }
+  auto l_linestatus() noexcept { return this->template Get<5>(); }
+  auto l_linestatus() const noexcept { return this->template Get<5>(); }
+  auto l_shipdate() noexcept { return this->template Get<6>(); }
+  auto l_shipdate() const noexcept { return this->template Get<6>(); }
+};
+
+using LineitemPageQ1 = BasicLineitemPageQ1<kPageSize>;
+
 static_assert(sizeof(LineitemPageQ1) == kPageSize);
 
-constexpr std::array<uint64_t, 11> kLineitemPageQ14MaxNumTuples = {
-    170, 341, 682, 1365, 2730, 5461, 10922, 21845, 43690, 87381, 174762};
-
-struct alignas(kPageSize) LineitemPageQ14 {
-  static constexpr uint64_t kMaxNumTuples =
-      kLineitemPageQ14MaxNumTuples[kPageSizePower - 12];
-  uint32_t num_tuples;
-  std::array<Integer, kMaxNumTuples> l_partkey;
-  std::array<Numeric<12, 2>, kMaxNumTuples> l_extendedprice;
-  std::array<Numeric<12, 2>, kMaxNumTuples> l_discount;
-  std::array<Date, kMaxNumTuples> l_shipdate;
+template <size_t kSize>
+struct BasicLineitemPageQ14
+    : PaxPage<kSize, Column<"l_partkey", Integer>,
+              Column<"l_extendedprice", Numeric<12, 2>>,
+              Column<"l_discount", Numeric<12, 2>>,
+              Column<"l_shipdate", Date>> {
+  static constexpr const auto &kTable = kLineitemTable;
+
+  auto l_partkey() noexcept { return this->template Get<0>(); }
+  auto l_partkey() const noexcept { return this->template Get<0>(); }
+  auto l_extendedprice() noexcept { return this->template Get<1>(); }
+  auto l_extendedprice() const noexcept { return this->template Get<1>(); }
+  auto l_discount() noexcept { return this->template Get<2>(); }
+  auto l_discount() const noexcept { return this->template Get<2>(); }
+  auto l_shipdate() noexcept { return this->template Get<3>(); }
+  auto l_shipdate() const noexcept { return this->template Get<3>(); }
 };
 
+using LineitemPageQ14 = BasicLineitemPageQ14<kPageSize>;
+
 static_assert(sizeof(LineitemPageQ14) == kPageSize);
 
-constexpr std::array<uint64_t, 11> kPartPageMaxNumTuples = {
-    24, 48, 96, 192, 385, 770, 1541, 3084, 6168, 12336, 24672};
-
-struct alignas(kPageSize) PartPage {
-  static constexpr uint64_t kMaxNumTuples =
-      kPartPageMaxNumTuples[kPageSizePower - 12];
-  uint32_t num_tuples;
-  std::array<Integer, kMaxNumTuples> p_partkey;
-  std::array<Varchar<55>, kMaxNumTuples> p_name;
-  std::array<Varchar<25>, kMaxNumTuples> p_mfgr;
-  std::array<Varchar<10>, kMaxNumTuples> p_brand;
-  std::array<Varchar<25>, kMaxNumTuples> p_type;
-  std::array<Integer, kMaxNumTuples> p_size;
-  std::array<Varchar<10>, kMaxNumTuples> p_container;
-  std::array<Numeric<12, 2>, kMaxNumTuples> p_retailprice;
-  std::array<Varchar<23>, kMaxNumTuples> p_comment;
+template <size_t kSize>
+struct BasicPartPage
+    : PaxPage<kSize, Column<"p_partkey", Integer>,
+              Column<"p_name", Varchar<55>>, Column<"p_mfgr", Varchar<25>>,
+              Column<"p_brand", Varchar<10>>, Column<"p_type", Varchar<25>>,
+              Column<"p_size", Integer>, Column<"p_container", Varchar<10>>,
+              Column<"p_retailprice", Numeric<12, 2>>,
+              Column<"p_comment", Varchar<23>>> {
+  static constexpr const auto &kTable = kPartTable;
+
+  auto p_partkey() noexcept { return this->template Get<0>(); }
+  auto p_partkey() const noexcept { return this->template Get<0>(); }
+  auto p_name() noexcept { return this->template Get<1>(); }
+  auto p_name() const noexcept { return this->template Get<1>(); }
+  auto p_mfgr() noexcept { return this->template Get<2>(); }
+  auto p_mfgr() const noexcept { return this->template Get<2>(); }
+  auto p_brand() noexcept { return this->template Get<3>(); }
+  auto p_brand() const noexcept { return this->template Get<3>(); }
+  auto p_type() noexcept { return this->template Get<4>(); }
+  auto p_type() const noexcept { return this->template Get<4>(); }
+  auto p_size() noexcept { return this->template Get<5>(); }
+  auto p_size() const noexcept { return this->template Get<5>(); }
+  auto p_container() noexcept { return this->template Get<6>(); }
+  auto p_container() const noexcept { return this->template Get<6>(); }
+  auto p_retailprice() noexcept { return this->template Get<7>(); }
+  auto p_retailprice() const noexcept { return this->template Get<7>(); }
+  auto p_comment() noexcept { return this->template Get<8>(); }
+  auto p_comment() const noexcept { return this->template Get<8>(); }
 };
 
+using PartPage = BasicPartPage<kPageSize>;
+
 static_assert(sizeof(PartPage) == kPageSize);
 
+// Contains only the columns of part that are needed by query 14
+template <size_t kSize>
+struct BasicPartPageQ14
+    : PaxPage<kSize, Column<"p_partkey", Integer>,
+              Column<"p_type", Varchar<25>>> {
+  static constexpr const auto &kTable = kPartTable;
+
+  auto p_partkey() noexcept { return this->template Get<0>(); }
+  auto p_partkey() const noexcept { return this->template Get<0>(); }
+  auto p_type() noexcept { return this->template Get<1>(); }
+  auto p_type() const noexcept { return this->template Get<1>(); }
+};
+
+using PartPageQ14 = BasicPartPageQ14<kPageSize>;
+
+static_assert(sizeof(PartPageQ14) == kPageSize);
+
+// All columns of lineitem, stored as one file per column
+struct LineitemColumns
+    : ColumnGroup<
+          Column<"l_orderkey", Integer>, Column<"l_partkey", Integer>,
+          Column<"l_suppkey", Integer>, Column<"l_linenumber", Integer>,
+          Column<"l_quantity", Numeric<12, 2>>,
+          Column<"l_extendedprice", Numeric<12, 2>>,
+          Column<"l_discount", Numeric<12, 2>>, Column<"l_tax", Numeric<12, 2>>,
+          Column<"l_returnflag", Char>, Column<"l_linestatus", Char>,
+          Column<"l_shipdate", Date>, Column<"l_commitdate", Date>,
+          Column<"l_receiptdate", Date>, Column<"l_shipinstruct", Varchar<25>>,
+          Column<"l_shipmode", Varchar<10>>, Column<"l_comment", Varchar<44>>> {
+  static constexpr const auto &kTable = kLineitemTable;
+};
+
+// The columns of lineitem that are read by query 1 from the column files
+struct LineitemColumnsQ1
+    : ColumnGroup<Column<"l_quantity", Numeric<12, 2>>,
+                  Column<"l_extendedprice", Numeric<12, 2>>,
+                  Column<"l_discount", Numeric<12, 2>>,
+                  Column<"l_tax", Numeric<12, 2>>, Column<"l_returnflag", Char>,
+                  Column<"l_linestatus", Char>, Column<"l_shipdate", Date>> {
+  static constexpr const auto &kTable = kLineitemTable;
+
+  auto l_quantity() noexcept { return this->template Get<0>(); }
+  auto l_quantity() const noexcept { return this->template Get<0>(); }
+  auto l_extendedprice() noexcept { return this->template Get<1>(); }
+  auto l_extendedprice() const noexcept { return this->template Get<1>(); }
+  auto l_discount() noexcept { return this->template Get<2>(); }
+  auto l_discount() const noexcept { return this->template Get<2>(); }
+  auto l_tax() noexcept { return this->template Get<3>(); }
+  auto l_tax() const noexcept { return this->template Get<3>(); }
+  auto l_returnflag() noexcept { return this->template Get<4>(); }
+  auto l_returnflag() const noexcept { return this->template Get<4>(); }
+  auto l_linestatus() noexcept { return this->template Get<5>(); }
+  auto l_linestatus() const noexcept { return this->template Get<5>(); }
+  auto l_shipdate() noexcept { return this->template Get<6>(); }
+  auto l_shipdate() const noexcept { return this->template Get<6>(); }
+};
+
 }  // namespace storage
 
-#endif  // STORAGE_SCHEMA_H_
\ No newline at end of file
+#endif  // STORAGE_SCHEMA_H_
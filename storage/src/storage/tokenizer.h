@@ -0,0 +1,125 @@
+#ifndef STORAGE_TOKENIZER_H_
+#define STORAGE_TOKENIZER_H_
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace storage {
+
+// Splits the lines of a .tbl file into their fields. In the style of the
+// structural index of simdjson, the positions of all delimiters ('|' and '\n')
+// of a block of 64 characters are computed at once as a bitmask, from which
+// they are then taken one after the other. Unlike finding every field with
+// FindPatternFast(), this inspects every character only once.
+class Tokenizer {
+ public:
+  // More fields of a line are skipped
+  static constexpr size_t kMaxNumFields = 16;
+
+  Tokenizer(const char *begin, const char *end) noexcept
+      : begin_(begin), block_(begin), end_(end), next_line_begin_(begin) {
+    if (begin < end) {
+      mask_ = ComputeMask(begin);
+    }
+  }
+
+  bool IsAtEnd() const noexcept { return next_line_begin_ >= end_; }
+
+  const char *GetBegin() const noexcept { return begin_; }
+
+  // Determines the fields of the next line
+  void NextLine() noexcept {
+    line_begin_ = next_line_begin_;
+    num_fields_ = 0;
+    while (true) {
+      const char *delimiter = NextDelimiter();
+      if (num_fields_ != kMaxNumFields) {
+        field_ends_[num_fields_++] = delimiter;
+      }
+      // the last line may lack its newline character
+      if (delimiter == end_ || *delimiter == '\n') {
+        next_line_begin_ = delimiter + 1;
+        return;
+      }
+    }
+  }
+
+  // The field is terminated by a delimiter or the end of the input
+  const char *GetFieldBegin(size_t field_index) const noexcept {
+    return field_index == 0 ? line_begin_ : field_ends_[field_index - 1] + 1;
+  }
+
+  const char *GetFieldEnd(size_t field_index) const noexcept {
+    return field_ends_[field_index];
+  }
+
+ private:
+  static constexpr size_t kBlockSize = 64;
+
+  // Returns the position of the next delimiter or end_ if there is none
+  const char *NextDelimiter() noexcept {
+    while (mask_ == 0) {
+      block_ += kBlockSize;
+      if (block_ >= end_) {
+        return end_;
+      }
+      mask_ = ComputeMask(block_);
+    }
+    const char *delimiter = block_ + std::countr_zero(mask_);
+    mask_ &= mask_ - 1;
+    return delimiter;
+  }
+
+  // Sets the bits of the delimiters of the block that starts at begin. The
+  // last block of the input is copied, so that no character behind end_ is
+  // read.
+  uint64_t ComputeMask(const char *begin) const noexcept {
+    size_t size = end_ - begin;
+    if (size >= kBlockSize) {
+      return ComputeMaskOf(begin);
+    }
+    alignas(kBlockSize) std::array<char, kBlockSize> block{};
+    std::memcpy(block.data(), begin, size);
+    return ComputeMaskOf(block.data());
+  }
+
+  static uint64_t ComputeMaskOf(const char *block) noexcept {
+#ifdef __AVX2__
+    const auto pipes = _mm256_set1_epi8('|');
+    const auto newlines = _mm256_set1_epi8('\n');
+    auto compare = [&](const char *iter) -> uint32_t {
+      auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(iter));
+      return _mm256_movemask_epi8(
+          _mm256_or_si256(_mm256_cmpeq_epi8(chars, pipes),
+                          _mm256_cmpeq_epi8(chars, newlines)));
+    };
+    return compare(block) | (uint64_t{compare(block + 32)} << 32);
+#else
+    uint64_t mask = 0;
+    for (size_t i = 0; i != kBlockSize; ++i) {
+      mask |= uint64_t{block[i] == '|' || block[i] == '\n'} << i;
+    }
+    return mask;
+#endif
+  }
+
+  const char *begin_;
+  const char *block_;
+  uint64_t mask_{0};
+  const char *end_;
+  const char *line_begin_{nullptr};
+  const char *next_line_begin_;
+  size_t num_fields_{0};
+  std::array<const char *, kMaxNumFields> field_ends_{};
+};
+
+}  // namespace storage
+
+#endif  // STORAGE_TOKENIZER_H_
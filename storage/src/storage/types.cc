@@ -1,6 +1,8 @@
 #include "storage/types.h"
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 
 namespace storage {
 
@@ -14,7 +16,7 @@ static ParseResult<uint32_t> ParseNumber(const char* iter,
 }
 
 // Algorithm from the Calendar FAQ
-static uint32_t MergeJulianDay(uint32_t year, uint32_t month,
+static constexpr uint32_t MergeJulianDay(uint32_t year, uint32_t month,
                                uint32_t day) noexcept {
   uint32_t a = (14 - month) / 12;
   uint32_t y = year + 4800 - a;
@@ -33,6 +35,45 @@ ParseResult<Date> Date::FromString(const char* iter, char delimiter) noexcept {
           parsed_day.end_it};
 }
 
+// The dates of TPC-H lie in [1992-01-01, 1998-12-31], for them the Julian day
+// of the first day of the month is looked up
+static constexpr uint32_t kFirstLookupYear = 1992;
+static constexpr uint32_t kNumLookupYears = 7;
+
+static constexpr auto kFirstJulianDayOfMonth = [] {
+  std::array<uint32_t, kNumLookupYears * 12> days{};
+  for (uint32_t year = 0; year != kNumLookupYears; ++year) {
+    for (uint32_t month = 0; month != 12; ++month) {
+      days[year * 12 + month] =
+          MergeJulianDay(kFirstLookupYear + year, month + 1, 1);
+    }
+  }
+  return days;
+}();
+
+Date Date::FromField(const char* begin, const char* end) noexcept {
+  if (end - begin != 10) {
+    return FromString(begin, *end).value;
+  }
+
+  // "YYYY-MM-" is loaded at once, the hyphens become zero
+  uint64_t chars;
+  std::memcpy(&chars, begin, sizeof(chars));
+  chars -= 0x2D30302D30303030;
+  // combine pairs of adjacent digits, i.e. 10 * first + second
+  chars = (chars * 10) + (chars >> 8);
+  uint32_t year = (chars & 0xFF) * 100 + ((chars >> 16) & 0xFF);
+  uint32_t month = (chars >> 40) & 0xFF;
+  uint32_t day = (begin[8] - '0') * 10 + (begin[9] - '0');
+
+  if (year - kFirstLookupYear < kNumLookupYears) {
+    return Date{kFirstJulianDayOfMonth[(year - kFirstLookupYear) * 12 +
+                                       month - 1] +
+                day - 1};
+  }
+  return Date{MergeJulianDay(year, month, day)};
+}
+
 // Algorithm from the Calendar FAQ
 static void SplitJulianDay(unsigned jd, unsigned& year, unsigned& month,
                            unsigned& day) {
@@ -74,4 +115,18 @@ ParseResult<Integer> Integer::FromString(const char* iter,
                               parsed_number.end_it};
 }
 
+Integer Integer::FromField(const char* begin, const char* end) noexcept {
+  size_t length = end - begin;
+  if (length == 0 || length > 16 || *begin == '-' || *begin == '+') {
+    return FromString(begin, *end).value;
+  }
+
+  auto value = detail::ParseEightDigits(
+      detail::LoadCharsBefore(end, length < 8 ? length : 8));
+  if (length > 8) {
+    value += detail::ParseDigits(begin, end - 8) * 100'000'000;
+  }
+  return Integer(value);
+}
+
 }  // namespace storage
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef STORAGE_TYPES_H_
 #define STORAGE_TYPES_H_
 
+#include <bit>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <ostream>
@@ -13,6 +15,48 @@ struct ParseResult {
   const char* end_it;
 };
 
+namespace detail {
+
+// Returns the value of 8 ASCII digits whose first digit is in the lowest byte
+// with the SWAR algorithm by Lemire
+inline uint64_t ParseEightDigits(uint64_t chars) noexcept {
+  constexpr uint64_t kMask = 0x000000FF000000FF;
+  constexpr uint64_t kMul1 = 100 + (1000000ull << 32);
+  constexpr uint64_t kMul2 = 1 + (10000ull << 32);
+  chars -= 0x3030303030303030;
+  chars = (chars * 10) + (chars >> 8);
+  return (((chars & kMask) * kMul1) + (((chars >> 16) & kMask) * kMul2)) >>
+         32;
+}
+
+// Loads the 1 <= n <= 8 characters in front of end into the highest bytes and
+// fills the other bytes with '0'. The 8 bytes in front of end must be
+// readable.
+inline uint64_t LoadCharsBefore(const char* end, size_t n) noexcept {
+  uint64_t chars;
+  std::memcpy(&chars, end - sizeof(chars), sizeof(chars));
+  uint64_t mask = ~uint64_t{0} << (8 * (8 - n));
+  return (chars & mask) | (0x3030303030303030 & ~mask);
+}
+
+// Sets the highest bit of every byte that equals c
+inline uint64_t FindBytes(uint64_t chars, char c) noexcept {
+  constexpr uint64_t kLow7Bits = 0x7F7F7F7F7F7F7F7F;
+  uint64_t x = chars ^ (0x0101010101010101 * static_cast<uint8_t>(c));
+  return ~(((x & kLow7Bits) + kLow7Bits) | x | kLow7Bits);
+}
+
+// Returns the value of the digits in [begin, end)
+inline uint64_t ParseDigits(const char* begin, const char* end) noexcept {
+  uint64_t value = 0;
+  for (; begin != end; ++begin) {
+    value = 10 * value + (*begin - '0');
+  }
+  return value;
+}
+
+}  // namespace detail
+
 using Char = char;
 
 class Date {
@@ -24,8 +68,13 @@ class Date {
   static ParseResult<Date> FromString(const char* iter,
                                       char delimiter) noexcept;
 
+  // Parses the field [begin, end), which is expected to be YYYY-MM-DD
+  static Date FromField(const char* begin, const char* end) noexcept;
+
   bool operator<=(Date d) const noexcept { return raw_ <= d.raw_; }
 
+  uint32_t GetRaw() const noexcept { return raw_; }
+
   friend std::ostream& operator<<(std::ostream& out, const Date& value);
 
  private:
@@ -77,6 +126,46 @@ class Numeric {
     }
   }
 
+  // Parses the field [begin, end) like FromString(), but the last 8
+  // characters, which contain the decimal point, are parsed at once. The 8
+  // bytes in front of end must be readable.
+  static Numeric FromField(const char* begin, const char* end) noexcept {
+    size_t length = end - begin;
+    if (length == 0 || length > 16 || *begin == '-' || *begin == '+') {
+      return FromString(begin, *end).value;
+    }
+
+    size_t word_length = length < 8 ? length : 8;
+    uint64_t chars = detail::LoadCharsBefore(end, word_length);
+    uint64_t digits = chars;
+    unsigned num_fraction_digits = 0;
+    uint64_t dot = detail::FindBytes(chars, '.');
+    if (dot != 0) {
+      // remove the decimal point by shifting the characters in front of it up
+      // by one byte
+      uint64_t before_dot = (dot >> 7) - 1;
+      uint64_t through_dot = ((dot >> 7) << 8) - 1;
+      digits = ((chars & before_dot) << 8) | (chars & ~through_dot) | 0x30;
+      num_fraction_digits = 7 - std::countr_zero(dot) / 8;
+    }
+    if (num_fraction_digits > 2) {
+      return FromString(begin, *end).value;
+    }
+
+    static_assert(kPrecision <= 2,
+                  "Higher precision not supported for parsing");
+    constexpr int64_t kShifts[] = {100ll, 10ll, 1ll};
+    int64_t result =
+        detail::ParseEightDigits(digits) * kShifts[num_fraction_digits];
+    if (length > 8) {
+      // the characters in front of the last 8 are integer digits
+      int64_t word_scale = dot == 0 ? 100'000'000 : 10'000'000;
+      result += detail::ParseDigits(begin, end - 8) * word_scale *
+                kShifts[num_fraction_digits];
+    }
+    return Numeric{result};
+  }
+
   Numeric& operator+=(Numeric<kLen, kPrecision> n) noexcept {
     raw_ += n.raw_;
     return *this;
@@ -129,6 +218,84 @@ class Numeric {
   int64_t raw_;
 };
 
+// Accumulates Numeric values in 128 bits, so that the sums over large scale
+// factors do not overflow. The sum is kept as its low and its high 64 bits
+// rather than as an __int128, because adding those with an explicit carry can
+// be vectorized.
+template <unsigned kLen, unsigned kPrecision>
+class NumericSum {
+ public:
+  NumericSum() noexcept = default;
+
+  explicit NumericSum(__int128 raw) noexcept
+      : low_(static_cast<uint64_t>(raw)),
+        high_(static_cast<int64_t>(raw >> 64)) {}
+
+  NumericSum& operator+=(Numeric<kLen, kPrecision> n) noexcept {
+    int64_t raw = n.GetRaw();
+    low_ += static_cast<uint64_t>(raw);
+    // sign-extend raw and add the carry out of the low half
+    high_ += (raw >> 63) + (low_ < static_cast<uint64_t>(raw));
+    return *this;
+  }
+
+  NumericSum& operator+=(NumericSum n) noexcept {
+    low_ += n.low_;
+    high_ += n.high_ + (low_ < n.low_);
+    return *this;
+  }
+
+  // The average of count values fits into a Numeric again
+  Numeric<kLen, kPrecision> operator/(uint64_t count) const noexcept {
+    return Numeric<kLen, kPrecision>{
+        static_cast<int64_t>(GetRaw() / static_cast<__int128>(count))};
+  }
+
+  // Like Numeric::operator/(), but the dividend is scaled in 128 bits
+  template <unsigned l>
+  Numeric<kLen, kPrecision> operator/(NumericSum<l, 4> n) const noexcept {
+    return Numeric<kLen, kPrecision>{
+        static_cast<int64_t>(GetRaw() * 10000 / n.GetRaw())};
+  }
+
+  __int128 GetRaw() const noexcept {
+    return static_cast<__int128>(static_cast<unsigned __int128>(high_) << 64 |
+                                 low_);
+  }
+
+ private:
+  uint64_t low_{0};
+  int64_t high_{0};
+};
+
+namespace detail {
+
+// Prints the raw value of a Numeric or a NumericSum with kPrecision digits
+// after the decimal point
+template <unsigned kPrecision>
+void PrintNumeric(std::ostream& out, __int128 raw) {
+  if (raw < 0) {
+    out << '-';
+    raw = -raw;
+  }
+  // the digits in reverse order, at least one in front of the decimal point
+  char digits[40];
+  unsigned num_digits = 0;
+  auto value = static_cast<unsigned __int128>(raw);
+  do {
+    digits[num_digits++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0 || num_digits <= kPrecision);
+  while (num_digits != 0) {
+    out << digits[--num_digits];
+    if (kPrecision != 0 && num_digits == kPrecision) {
+      out << '.';
+    }
+  }
+}
+
+}  // namespace detail
+
 class Integer {
  public:
   Integer() noexcept : value_(0) {}
@@ -138,6 +305,10 @@ class Integer {
   static ParseResult<Integer> FromString(const char* iter,
                                          char delimiter) noexcept;
 
+  // Parses the field [begin, end) like FromString(), but the last 8 digits
+  // are parsed at once. The 8 bytes in front of end must be readable.
+  static Integer FromField(const char* begin, const char* end) noexcept;
+
   uint64_t hash() const {
     uint64_t r = 88172645463325252ull ^ value_;
     r ^= (r << 13);
@@ -206,33 +377,14 @@ class Varchar {
 template <unsigned kLen, unsigned kPrecision>
 std::ostream& operator<<(std::ostream& out,
                          storage::Numeric<kLen, kPrecision> n) {
-  int64_t raw = n.GetRaw();
-  if (raw < 0) {
-    out << '-';
-    raw = -raw;
-  }
-  if (kPrecision == 0) {
-    out << raw;
-  } else {
-    int64_t sep = 10;
-    for (unsigned index = 1; index < kPrecision; ++index) {
-      sep *= 10;
-    }
-    out << (raw / sep);
-    out << '.';
-    raw = raw % sep;
-    if (!raw) {
-      for (unsigned index = 0; index < kPrecision; ++index) {
-        out << '0';
-      }
-    } else {
-      while (sep > (10 * raw)) {
-        out << '0';
-        sep /= 10;
-      }
-      out << raw;
-    }
-  }
+  storage::detail::PrintNumeric<kPrecision>(out, n.GetRaw());
+  return out;
+}
+
+template <unsigned kLen, unsigned kPrecision>
+std::ostream& operator<<(std::ostream& out,
+                         storage::NumericSum<kLen, kPrecision> n) {
+  storage::detail::PrintNumeric<kPrecision>(out, n.GetRaw());
   return out;
 }
 
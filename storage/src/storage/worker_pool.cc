@@ -0,0 +1,99 @@
+#include "storage/worker_pool.h"
+
+#include "cppcoro/allocator.hpp"
+#include "cppcoro/sync_wait.hpp"
+#include "cppcoro/task.hpp"
+
+namespace storage {
+
+Worker::Worker(unsigned index, NumaNode node, unsigned num_ring_entries)
+    : index_(index), node_(node) {
+  if (num_ring_entries > 0) {
+    ring_.emplace(num_ring_entries);
+  }
+}
+
+Worker::~Worker() {
+  if (buffer_ != nullptr) {
+    ::operator delete(buffer_, std::align_val_t{buffer_alignment_});
+  }
+}
+
+void Worker::Reserve(size_t size, size_t alignment) {
+  if (size <= buffer_size_ && alignment <= buffer_alignment_) {
+    return;
+  }
+  if (buffer_ != nullptr) {
+    ::operator delete(buffer_, std::align_val_t{buffer_alignment_});
+  }
+  buffer_size_ = std::max(size, buffer_size_);
+  buffer_alignment_ = std::max(alignment, buffer_alignment_);
+  buffer_ = ::operator new(buffer_size_, std::align_val_t{buffer_alignment_});
+}
+
+WorkerPool::WorkerPool(unsigned num_threads, unsigned num_ring_entries) {
+  threads_.reserve(num_threads);
+  for (unsigned i = 0; i != num_threads; ++i) {
+    threads_.emplace_back(&WorkerPool::Work, this, i, num_ring_entries);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard lock{mutex_};
+    stop_ = true;
+    ++generation_;
+  }
+  job_available_.notify_all();
+  for (auto &t : threads_) {
+    t.join();
+  }
+}
+
+void WorkerPool::Run(const std::function<void(Worker &)> &job) {
+  std::unique_lock lock{mutex_};
+  job_ = &job;
+  num_running_ = threads_.size();
+  ++generation_;
+  job_available_.notify_all();
+  job_done_.wait(lock, [this] { return num_running_ == 0; });
+  job_ = nullptr;
+}
+
+void WorkerPool::Work(unsigned index, unsigned num_ring_entries) {
+  // spread the threads evenly across the NUMA nodes
+  const auto &nodes = GetNumaNodes();
+  auto node = nodes[index % nodes.size()];
+  BindCurrentThreadToNumaNode(node);
+
+  // the ring and the page buffers are allocated after binding the thread, so
+  // their memory is local to its node
+  Worker worker{index, node, num_ring_entries};
+  cppcoro::detail::allocator =
+      new Allocator(std::max(num_ring_entries, 1u));
+  cppcoro::detail::sync_allocator = new Allocator(1);
+
+  uint64_t generation = 0;
+  std::unique_lock lock{mutex_};
+  while (true) {
+    job_available_.wait(lock, [&] { return generation_ != generation; });
+    generation = generation_;
+    if (stop_) {
+      break;
+    }
+    const auto &job = *job_;
+    lock.unlock();
+    job(worker);
+    lock.lock();
+    if (--num_running_ == 0) {
+      job_done_.notify_one();
+    }
+  }
+
+  delete cppcoro::detail::allocator;
+  cppcoro::detail::allocator = nullptr;
+  delete cppcoro::detail::sync_allocator;
+  cppcoro::detail::sync_allocator = nullptr;
+}
+
+}  // namespace storage
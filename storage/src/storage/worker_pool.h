@@ -0,0 +1,93 @@
+#ifndef STORAGE_WORKER_POOL_H_
+#define STORAGE_WORKER_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "storage/file.h"
+#include "storage/io_uring.h"
+#include "storage/numa.h"
+
+namespace storage {
+
+// The state of a thread of a WorkerPool that outlives the jobs it runs
+class Worker {
+ public:
+  Worker(unsigned index, NumaNode node, unsigned num_ring_entries);
+
+  ~Worker();
+
+  Worker(const Worker &) = delete;
+  Worker &operator=(const Worker &) = delete;
+
+  unsigned GetIndex() const noexcept { return index_; }
+
+  NumaNode GetNode() const noexcept { return node_; }
+
+  // The io_uring of the worker, which has the num_ring_entries of the pool.
+  // nullptr if the pool has no rings.
+  IOUring *GetRing() noexcept { return ring_ ? &*ring_ : nullptr; }
+
+  // Returns num_pages uninitialized pages that are local to the node of the
+  // worker. They are reused by the next call, which invalidates them.
+  template <typename Page>
+  Page *GetPages(size_t num_pages) {
+    Reserve(num_pages * sizeof(Page), std::max(alignof(Page), kIOAlignment));
+    return static_cast<Page *>(buffer_);
+  }
+
+ private:
+  void Reserve(size_t size, size_t alignment);
+
+  const unsigned index_;
+  const NumaNode node_;
+  std::optional<IOUring> ring_;
+  void *buffer_{nullptr};
+  size_t buffer_size_{0};
+  size_t buffer_alignment_{0};
+};
+
+// Threads that are started once and then run the jobs of many queries. Thread
+// i is bound to the NUMA node GetNumaNodes()[i % n] and keeps its io_uring,
+// its coroutine allocators and its page buffers across jobs, so a query does
+// not pay for setting them up.
+class WorkerPool {
+ public:
+  // The workers get rings with num_ring_entries entries if it is positive
+  WorkerPool(unsigned num_threads, unsigned num_ring_entries);
+
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  unsigned GetNumThreads() const noexcept { return threads_.size(); }
+
+  // Calls job on every worker and returns once all calls have returned
+  void Run(const std::function<void(Worker &)> &job);
+
+ private:
+  void Work(unsigned index, unsigned num_ring_entries);
+
+  std::mutex mutex_;
+  std::condition_variable job_available_;
+  std::condition_variable job_done_;
+  const std::function<void(Worker &)> *job_{nullptr};
+  // incremented for every job, so that no worker runs a job twice
+  uint64_t generation_{0};
+  unsigned num_running_{0};
+  bool stop_{false};
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace storage
+
+#endif  // STORAGE_WORKER_POOL_H_
@@ -0,0 +1,34 @@
+#include "storage/zone_map.h"
+
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace storage {
+
+ZoneMap ZoneMap::ReadFor(const char *path_to_data, size_t num_columns) {
+  auto path = GetPath(path_to_data);
+  if (access(path.c_str(), F_OK) != 0) {
+    return ZoneMap{num_columns};
+  }
+
+  const File file{path.c_str(), File::kRead};
+  auto size = file.ReadSize();
+  if (size % (num_columns * sizeof(Zone)) != 0) {
+    throw std::runtime_error{"The zone map does not match the data file"};
+  }
+
+  ZoneMap zone_map{num_columns};
+  zone_map.zones_.resize(size / sizeof(Zone));
+  file.ReadBlock(reinterpret_cast<std::byte *>(zone_map.zones_.data()), 0,
+                 size);
+  return zone_map;
+}
+
+void ZoneMap::WriteFor(const char *path_to_data) const {
+  File file{GetPath(path_to_data).c_str(), File::kWrite};
+  file.AppendBlock(reinterpret_cast<const std::byte *>(zones_.data()),
+                   zones_.size() * sizeof(Zone));
+}
+
+}  // namespace storage
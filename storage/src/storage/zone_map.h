@@ -0,0 +1,152 @@
+#ifndef STORAGE_ZONE_MAP_H_
+#define STORAGE_ZONE_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/compression.h"
+#include "storage/file.h"
+
+namespace storage {
+
+// The smallest and the largest value of a column on a page. The values are
+// compared by their raw integers (see detail::ToRaw()), which preserves the
+// order of all fixed-size column types.
+struct Zone {
+  int64_t min;
+  int64_t max;
+};
+
+// How many values of a column on a page lie in a given range
+enum class ZoneMatch { kNone, kSome, kAll };
+
+// The zones of every column of every page of a data file. load_data stores the
+// zone map next to the data file so that the queries can skip pages without
+// reading them.
+class ZoneMap {
+ public:
+  ZoneMap() = default;
+
+  explicit ZoneMap(size_t num_columns) noexcept : num_columns_(num_columns) {}
+
+  static std::string GetPath(const char *path_to_data) {
+    return std::string{path_to_data} + ".zonemap";
+  }
+
+  // Reads the zone map of the data file. Returns an empty zone map if the data
+  // file has none.
+  static ZoneMap ReadFor(const char *path_to_data, size_t num_columns);
+
+  void WriteFor(const char *path_to_data) const;
+
+  // Computes the zone map of a data file consisting of pages of type Page
+  template <typename Page>
+  static ZoneMap Compute(const char *path_to_data) {
+    ZoneMap zone_map{Page::kNumColumns};
+    zone_map.Update<Page>(path_to_data, 0);
+    return zone_map;
+  }
+
+  // Recomputes the zones of the pages from first_page_index on, e.g. after
+  // tuples were appended to the data file
+  template <typename Page>
+  void Update(const char *path_to_data, PageIndex first_page_index) {
+    const File file{path_to_data, File::kRead};
+    auto num_pages = file.GetNumPages(sizeof(Page));
+    first_page_index = std::min<PageIndex>(first_page_index, GetNumPages());
+    zones_.resize(first_page_index * num_columns_);
+    zones_.reserve(num_pages * num_columns_);
+
+    auto page = std::make_unique<Page>();
+    if constexpr (IsCompressedPage<Page>::value) {
+      auto decoded = std::make_unique<typename Page::Staging>();
+      for (auto page_index = first_page_index; page_index < num_pages;
+           ++page_index) {
+        file.ReadPage(page_index, page.get());
+        page->DecodeBlock(0, *decoded);
+        AddPage(*decoded);
+      }
+    } else {
+      for (auto page_index = first_page_index; page_index < num_pages;
+           ++page_index) {
+        file.ReadPage(page_index, page.get());
+        AddPage(*page);
+      }
+    }
+  }
+
+  // Appends the zones of an uncompressed page
+  template <typename Page>
+  void AddPage(const Page &page) {
+    [&]<size_t... kIndexes>(std::index_sequence<kIndexes...>) {
+      (zones_.push_back(
+           ComputeZone(page.template Get<kIndexes>().first(page.num_tuples))),
+       ...);
+    }(std::make_index_sequence<Page::kNumColumns>{});
+  }
+
+  bool IsEmpty() const noexcept { return zones_.empty(); }
+
+  uint64_t GetNumPages() const noexcept {
+    return num_columns_ == 0 ? 0 : zones_.size() / num_columns_;
+  }
+
+  Zone GetZone(PageIndex page_index, size_t column_index) const noexcept {
+    return zones_[page_index * num_columns_ + column_index];
+  }
+
+  // Returns whether none, some or all values of the column on the page lie in
+  // [low, high]. Pages that are not covered by the zone map match kSome.
+  template <typename T>
+  ZoneMatch Match(PageIndex page_index, size_t column_index, T low,
+                  T high) const noexcept {
+    if (page_index >= GetNumPages()) {
+      return ZoneMatch::kSome;
+    }
+    auto zone = GetZone(page_index, column_index);
+    auto raw_low = detail::ToRaw(low);
+    auto raw_high = detail::ToRaw(high);
+    if (zone.max < raw_low || raw_high < zone.min) {
+      return ZoneMatch::kNone;
+    }
+    if (raw_low <= zone.min && zone.max <= raw_high) {
+      return ZoneMatch::kAll;
+    }
+    return ZoneMatch::kSome;
+  }
+
+ private:
+  // An empty page gets an empty zone that matches no range. Columns whose
+  // values are not integers (e.g. Varchar) get a zone that matches any range.
+  template <typename T>
+  static Zone ComputeZone(std::span<const T> values) noexcept {
+    if constexpr (sizeof(T) != 1 && sizeof(T) != 2 && sizeof(T) != 4 &&
+                  sizeof(T) != 8) {
+      return {std::numeric_limits<int64_t>::min(),
+              std::numeric_limits<int64_t>::max()};
+    } else {
+      Zone zone{std::numeric_limits<int64_t>::max(),
+                std::numeric_limits<int64_t>::min()};
+      for (const auto &value : values) {
+        auto raw = detail::ToRaw(value);
+        zone.min = std::min(zone.min, raw);
+        zone.max = std::max(zone.max, raw);
+      }
+      return zone;
+    }
+  }
+
+  std::vector<Zone> zones_;
+  size_t num_columns_{0};
+};
+
+}  // namespace storage
+
+#endif  // STORAGE_ZONE_MAP_H_